@@ -39,6 +39,8 @@ header_files = [
     "../src/game_api/screen_arena.hpp",
     "../src/game_api/online.hpp",
     "../src/game_api/strings.hpp",
+    "../src/game_api/grid_raycast.hpp",
+    "../src/game_api/tile_map.hpp",
     "../src/game_api/script/usertypes/level_lua.hpp",
     "../src/game_api/script/usertypes/gui_lua.hpp",
     "../src/game_api/script/usertypes/vanilla_render_lua.hpp",
@@ -81,6 +83,9 @@ api_files = [
     "../src/game_api/script/usertypes/flags_lua.cpp",
     "../src/game_api/script/usertypes/char_state_lua.cpp",
     "../src/game_api/script/usertypes/hitbox_lua.cpp",
+    "../src/game_api/script/usertypes/entity_type_set_lua.cpp",
+    "../src/game_api/script/usertypes/tile_map_lua.cpp",
+    "../src/game_api/script/usertypes/pathfinding_lua.cpp",
     "../src/game_api/script/usertypes/screen_lua.cpp",
     "../src/game_api/script/usertypes/screen_arena_lua.cpp",
 ]
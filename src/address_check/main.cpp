@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "address_rules.hpp"
+#include "drops.hpp"
+#include "pattern_scan.hpp"
+#include "pe_image.hpp"
+
+// Runs every address rule and drop pattern against a Spel2.exe on disk and reports which of them are missing, which
+// leading patterns are ambiguous and how long every rule takes, returns 1 if any required pattern is missing
+//
+// Usage: address_check <path/to/Spel2.exe>
+
+using clock_type = std::chrono::steady_clock;
+
+struct RuleResult
+{
+    std::optional<size_t> address;
+    bool missing{false};
+    bool optional_missing{false};
+    size_t leading_matches{0};
+    clock_type::duration duration{};
+};
+
+size_t count_matches(const char* exe, std::string_view pattern, size_t start, size_t end)
+{
+    const PatternScanner scanner{pattern};
+    size_t matches = 0;
+    while (auto hit = scanner.find(exe, start, end))
+    {
+        matches++;
+        start = hit.value() + 1;
+    }
+    return matches;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fmt::print("Usage: {} <path/to/Spel2.exe>\n", argv[0]);
+        return 1;
+    }
+
+    std::string error;
+    const auto pe_image = PeImage::load(argv[1], error);
+    if (!pe_image.has_value())
+    {
+        fmt::print("{}\n", error);
+        return 1;
+    }
+
+    const char* exe = pe_image->data();
+    const size_t code_end = pe_image->code_end();
+    const auto after_bundle = PatternScanner{g_after_bundle_pattern}.find(exe, bundle_end(exe), code_end);
+    if (!after_bundle.has_value())
+    {
+        fmt::print("Could not find the end of the asset bundle\n");
+        return 1;
+    }
+
+    std::map<std::string_view, RuleResult> results;
+    std::set<std::string_view> rules_in_progress;
+    std::string_view current_rule;
+    std::function<size_t(std::string_view)> resolve;
+
+    AddressRuleContext context{
+        .exe = exe,
+        .after_bundle = after_bundle.value(),
+        .code_end = code_end,
+        .get_address = [&](std::string_view address_name)
+        { return resolve(address_name); },
+        .get_virtual_function_address = [&](VTABLE_OFFSET table_offset, uint32_t function_index) -> size_t
+        {
+            const size_t first_table_entry = resolve("virtual_functions_table");
+            if (first_table_entry == 0)
+            {
+                return 0;
+            }
+            // The table holds absolute pointers for the preferred base since the image is not relocated
+            const size_t* func_address = reinterpret_cast<const size_t*>(first_table_entry + ((static_cast<size_t>(table_offset) + function_index) * sizeof(size_t)));
+            return *func_address - pe_image->image_base();
+        },
+        .find_inst = [&](std::string_view pattern, size_t start, size_t end, std::string_view, bool is_required) -> std::optional<size_t>
+        {
+            if (auto hit = PatternScanner{pattern}.find(exe, start, std::min(end, code_end)))
+            {
+                return hit;
+            }
+            (is_required ? results[current_rule].missing : results[current_rule].optional_missing) = true;
+            return std::nullopt;
+        },
+    };
+
+    resolve = [&](std::string_view address_name) -> size_t
+    {
+        auto rule = g_address_rules.find(address_name);
+        if (rule == g_address_rules.end())
+        {
+            results[current_rule].missing = true;
+            fmt::print("Rule '{}' depends on unknown address '{}'\n", current_rule, address_name);
+            return 0;
+        }
+        if (auto it = results.find(rule->first); it != results.end() && it->second.address.has_value())
+        {
+            return it->second.address.value();
+        }
+        if (!rules_in_progress.insert(rule->first).second)
+        {
+            results[current_rule].missing = true;
+            fmt::print("Rule '{}' has a cyclic dependency on '{}'\n", current_rule, address_name);
+            return 0;
+        }
+
+        // Dependencies are resolved first so they are not part of the timing of this rule, unknown ones are reported
+        // when the rule itself asks for them
+        for (std::string_view dependency : rule->second.dependencies())
+        {
+            if (g_address_rules.contains(dependency))
+            {
+                resolve(dependency);
+            }
+        }
+
+        const std::string_view outer_rule = std::exchange(current_rule, rule->first);
+        RuleResult& result = results[rule->first];
+        const auto start = clock_type::now();
+        result.address = rule->second(context, rule->first);
+        result.duration = clock_type::now() - start;
+        if (auto pattern = rule->second.leading_pattern())
+        {
+            result.leading_matches = count_matches(exe, pattern.value(), context.after_bundle, code_end);
+        }
+        current_rule = outer_rule;
+        rules_in_progress.erase(rule->first);
+        return result.address.value_or(0);
+    };
+
+    for (auto& [address_name, rule] : g_address_rules)
+    {
+        resolve(address_name);
+    }
+
+    auto format_address = [&](size_t address)
+    {
+        if (address >= (size_t)exe && address < (size_t)exe + pe_image->size())
+        {
+            return fmt::format("exe+0x{:x}", address - (size_t)exe);
+        }
+        return fmt::format("0x{:x}", address);
+    };
+
+    size_t num_missing = 0;
+    size_t num_duplicates = 0;
+    clock_type::duration total_duration{};
+    fmt::print("{:<48} {:<10} {:<20} {:>10} {:>8}\n", "rule", "status", "address", "time (us)", "matches");
+    for (auto& [address_name, result] : results)
+    {
+        std::string_view status = "ok";
+        if (result.missing)
+        {
+            status = "MISSING";
+            num_missing++;
+        }
+        else if (result.optional_missing)
+        {
+            status = "optional";
+        }
+        else if (result.leading_matches > 1)
+        {
+            status = "DUPLICATE";
+            num_duplicates++;
+        }
+        total_duration += result.duration;
+
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(result.duration).count();
+        fmt::print("{:<48} {:<10} {:<20} {:>10} {:>8}\n", address_name, status, format_address(result.address.value_or(0)), micros, result.leading_matches);
+    }
+
+    // Drops are either searched in the whole executable or in a virtual function, see replace_drop and set_drop_chance
+    auto check_drop = [&](std::string_view kind, const std::string& caption, const std::string& pattern, VTABLE_OFFSET vtable_offset, uint32_t vtable_rel_offset, size_t expected_matches)
+    {
+        if (vtable_offset == VTABLE_OFFSET::NONE)
+        {
+            const size_t matches = count_matches(exe, pattern, context.after_bundle, code_end);
+            if (matches < expected_matches)
+            {
+                fmt::print("{} {}: MISSING, found {} of {} matches\n", kind, caption, matches, expected_matches);
+                num_missing++;
+            }
+            else if (matches > expected_matches)
+            {
+                fmt::print("{} {}: DUPLICATE, found {} matches where {} were expected\n", kind, caption, matches, expected_matches);
+                num_duplicates++;
+            }
+            return;
+        }
+
+        const size_t function_address = context.get_virtual_function_address(vtable_offset, vtable_rel_offset);
+        if (auto hit = PatternScanner{pattern}.find(exe, function_address, code_end))
+        {
+            fmt::print("{} {}: found 0x{:x} bytes into the virtual function\n", kind, caption, hit.value() - function_address);
+        }
+        else
+        {
+            fmt::print("{} {}: MISSING in the virtual function\n", kind, caption);
+            num_missing++;
+        }
+    };
+    for (const DropEntry& drop : drop_entries)
+    {
+        check_drop("DROP", drop.caption, drop.pattern, drop.vtable_offset, drop.vtable_rel_offset, (size_t)drop.skip + drop.vtable_occurrence);
+    }
+    for (const DropChanceEntry& dropchance : dropchance_entries)
+    {
+        check_drop("DROPCHANCE", dropchance.caption, dropchance.pattern, dropchance.vtable_offset, dropchance.vtable_rel_offset, 1);
+    }
+
+    fmt::print(
+        "\n{} rules resolved in {}us, {} missing, {} duplicate\n",
+        results.size(),
+        std::chrono::duration_cast<std::chrono::microseconds>(total_duration).count(),
+        num_missing,
+        num_duplicates);
+    return num_missing > 0 ? 1 : 0;
+}
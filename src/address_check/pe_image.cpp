@@ -0,0 +1,100 @@
+#include "pe_image.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+template <class T>
+std::optional<T> read_at(const std::vector<char>& file, size_t offset)
+{
+    if (offset + sizeof(T) > file.size())
+    {
+        return std::nullopt;
+    }
+    T value;
+    std::memcpy(&value, file.data() + offset, sizeof(T));
+    return value;
+}
+} // namespace
+
+std::optional<PeImage> PeImage::load(const std::string& path, std::string& error)
+{
+    std::ifstream file_stream{path, std::ios::binary};
+    if (!file_stream)
+    {
+        error = "Could not open '" + path + "'";
+        return std::nullopt;
+    }
+    const std::vector<char> file{std::istreambuf_iterator<char>{file_stream}, std::istreambuf_iterator<char>{}};
+
+    // IMAGE_DOS_HEADER::e_lfanew points at the "PE\0\0" signature, followed by IMAGE_FILE_HEADER and IMAGE_OPTIONAL_HEADER64
+    const auto nt_header = read_at<uint32_t>(file, 0x3c);
+    if (read_at<uint16_t>(file, 0) != uint16_t{0x5a4d} || !nt_header || read_at<uint32_t>(file, nt_header.value()) != uint32_t{0x4550})
+    {
+        error = "'" + path + "' is not a PE file";
+        return std::nullopt;
+    }
+
+    const size_t file_header = nt_header.value() + 4;
+    const size_t optional_header = file_header + 20;
+    const auto num_sections = read_at<uint16_t>(file, file_header + 2);
+    const auto optional_header_size = read_at<uint16_t>(file, file_header + 16);
+    if (!num_sections || !optional_header_size || read_at<uint16_t>(file, optional_header) != uint16_t{0x20b})
+    {
+        error = "'" + path + "' is not a 64 bit PE file";
+        return std::nullopt;
+    }
+
+    const auto size_of_code = read_at<uint32_t>(file, optional_header + 4);
+    const auto base_of_code = read_at<uint32_t>(file, optional_header + 20);
+    const auto image_base = read_at<uint64_t>(file, optional_header + 24);
+    const auto size_of_image = read_at<uint32_t>(file, optional_header + 56);
+    const auto size_of_headers = read_at<uint32_t>(file, optional_header + 60);
+    if (!size_of_code || !base_of_code || !image_base || !size_of_image || !size_of_headers || size_of_headers.value() > file.size() || size_of_headers.value() > size_of_image.value())
+    {
+        error = "'" + path + "' has a corrupt optional header";
+        return std::nullopt;
+    }
+
+    PeImage pe_image;
+    pe_image.image.resize(size_of_image.value());
+    pe_image.preferred_base = image_base.value();
+    pe_image.code_section_end = (size_t)base_of_code.value() + size_of_code.value();
+    pe_image.headers_size = size_of_headers.value();
+    std::memcpy(pe_image.image.data(), file.data(), size_of_headers.value());
+
+    // IMAGE_SECTION_HEADER, only the sizes and offsets are needed
+    const size_t section_table = optional_header + optional_header_size.value();
+    for (uint16_t i = 0; i < num_sections.value(); i++)
+    {
+        const size_t section = section_table + i * 40;
+        const auto virtual_size = read_at<uint32_t>(file, section + 8);
+        const auto virtual_address = read_at<uint32_t>(file, section + 12);
+        const auto raw_size = read_at<uint32_t>(file, section + 16);
+        const auto raw_offset = read_at<uint32_t>(file, section + 20);
+        if (!virtual_size || !virtual_address || !raw_size || !raw_offset)
+        {
+            error = "'" + path + "' has a corrupt section table";
+            return std::nullopt;
+        }
+
+        const size_t copy_size = std::min(raw_size.value(), virtual_size.value());
+        if ((size_t)raw_offset.value() + copy_size > file.size() || (size_t)virtual_address.value() + copy_size > pe_image.image.size())
+        {
+            error = "'" + path + "' has a section outside of the file or image";
+            return std::nullopt;
+        }
+        std::memcpy(pe_image.image.data() + virtual_address.value(), file.data() + raw_offset.value(), copy_size);
+    }
+
+    if (pe_image.code_section_end > pe_image.image.size())
+    {
+        error = "'" + path + "' has a code section outside of the image";
+        return std::nullopt;
+    }
+
+    return pe_image;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal loader for 64 bit PE files that lays out the sections at their virtual addresses, like the Windows loader
+// would, without applying relocations or resolving imports
+// This is enough to run the address rules against an executable on disk without starting the game
+class PeImage
+{
+  public:
+    // Returns std::nullopt and sets error if the file can't be read or is not a 64 bit PE file
+    static std::optional<PeImage> load(const std::string& path, std::string& error);
+
+    const char* data() const
+    {
+        return image.data();
+    }
+    size_t size() const
+    {
+        return image.size();
+    }
+
+    // Base the image was linked for, absolute pointers inside the unrelocated image are relative to this
+    uint64_t image_base() const
+    {
+        return preferred_base;
+    }
+    size_t code_end() const
+    {
+        return code_section_end;
+    }
+    std::string_view headers() const
+    {
+        return {image.data(), headers_size};
+    }
+
+  private:
+    std::vector<char> image;
+    uint64_t preferred_base{0};
+    size_t code_section_end{0};
+    size_t headers_size{0};
+};
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "entity_hooks_registry.hpp"
+
+// Stress test of EntityHooksRegistry, the registry Entity::get_hooks uses, with thousands of hooked entities, compares
+// it against the std::vector of EntityHooksInfo that was searched linearly before
+// Every frame the statemachine detour looks up the hooks of every hooked entity, a few entities die and get replaced
+// by new hooked ones like with a script that hooks every spawned monster
+//
+// Usage: entity_hooks_bench
+
+using clock_type = std::chrono::steady_clock;
+
+// The registry as it was before EntityHooksRegistry, only kept as the baseline
+struct LinearRegistry
+{
+    std::vector<EntityHooksInfo> hooks;
+
+    std::pair<EntityHooksInfo&, bool> get_or_add(void* entity)
+    {
+        auto it = std::find_if(hooks.begin(), hooks.end(), [entity](auto& hook)
+                               { return hook.entity == entity; });
+        if (it == hooks.end())
+        {
+            hooks.push_back({entity});
+            return {hooks.back(), true};
+        }
+        return {*it, false};
+    }
+    void on_dtor(void* entity)
+    {
+        auto it = std::find_if(hooks.begin(), hooks.end(), [entity](auto& hook)
+                               { return hook.entity == entity; });
+        if (it != hooks.end())
+        {
+            for (auto& cb : it->on_dtor)
+            {
+                cb.fun(static_cast<Entity*>(entity));
+            }
+            hooks.erase(it);
+        }
+    }
+};
+
+// Stands in for the entities of the game, the registry only ever looks at their address
+struct MockEntity
+{
+    std::uint32_t uid;
+    uint8_t data[0x100];
+};
+
+template <class Registry>
+double run_frames(size_t num_entities, size_t num_frames, uint64_t& checksum)
+{
+    // Entities are spread in memory like the ones of the game's pools
+    std::vector<std::unique_ptr<MockEntity>> entities;
+    std::uint32_t next_uid = 0;
+    for (size_t i = 0; i < num_entities; i++)
+    {
+        entities.push_back(std::make_unique<MockEntity>(MockEntity{next_uid++}));
+    }
+    std::mt19937 rng{1234};
+    std::shuffle(entities.begin(), entities.end(), rng);
+
+    Registry registry;
+    for (auto& entity : entities)
+    {
+        EntityHooksInfo& hooks = registry.get_or_add(entity.get()).first;
+        hooks.pre_statemachine.push_back({hooks.cbcount++, [](Movable*)
+                                          { return false; }});
+    }
+
+    const size_t deaths_per_frame = std::max<size_t>(num_entities / 100, 1);
+    const auto start = clock_type::now();
+    for (size_t frame = 0; frame < num_frames; frame++)
+    {
+        for (auto& entity : entities)
+        {
+            EntityHooksInfo& hooks = registry.get_or_add(entity.get()).first;
+            for (auto& hook : hooks.pre_statemachine)
+            {
+                checksum += hook.fun(reinterpret_cast<Movable*>(entity.get())) ? 1 : hook.id + 1;
+            }
+        }
+        for (size_t i = 0; i < deaths_per_frame; i++)
+        {
+            auto& entity = entities[rng() % entities.size()];
+            registry.on_dtor(entity.get());
+            entity = std::make_unique<MockEntity>(MockEntity{next_uid++});
+            EntityHooksInfo& hooks = registry.get_or_add(entity.get()).first;
+            hooks.pre_statemachine.push_back({hooks.cbcount++, [](Movable*)
+                                              { return false; }});
+        }
+    }
+    const auto duration = std::chrono::duration<double, std::micro>(clock_type::now() - start);
+    return duration.count() / static_cast<double>(num_frames);
+}
+
+int main()
+{
+    // References handed out by get_or_add have to survive other entities getting hooked and unhooked, on_dtor has to run
+    // the callbacks of the entity once and forget it
+    {
+        std::vector<std::unique_ptr<MockEntity>> entities;
+        for (std::uint32_t i = 0; i < 10000; i++)
+        {
+            entities.push_back(std::make_unique<MockEntity>(MockEntity{i}));
+        }
+        EntityHooksRegistry registry;
+        auto [first_hooks, first_inserted] = registry.get_or_add(entities[0].get());
+        size_t num_dtor_calls = 0;
+        size_t num_erased = 0;
+        for (size_t i = 1; i < entities.size(); i++)
+        {
+            EntityHooksInfo& hooks = registry.get_or_add(entities[i].get()).first;
+            hooks.on_dtor.push_back({hooks.cbcount++, [&num_dtor_calls, expected = entities[i].get()](Entity* entity)
+                                     { num_dtor_calls += reinterpret_cast<void*>(entity) == expected ? 1 : 1000; }});
+            if (i % 2 == 0)
+            {
+                registry.on_dtor(entities[i - 1].get());
+                registry.on_dtor(entities[i - 1].get());
+                num_erased++;
+            }
+        }
+        const bool reused = !registry.get_or_add(entities[0].get()).second && &registry.get_or_add(entities[0].get()).first == &first_hooks;
+        if (!first_inserted || !reused || first_hooks.entity != entities[0].get())
+        {
+            fmt::print("FAILED: EntityHooksInfo moved while other entities were hooked\n");
+            return 1;
+        }
+        if (num_dtor_calls != num_erased || registry.size() != entities.size() - num_erased || registry.find(entities[1].get()) != nullptr)
+        {
+            fmt::print("FAILED: on_dtor did not run the callbacks of the entity once and drop its hooks\n");
+            return 1;
+        }
+    }
+
+    uint64_t checksum = 0;
+    fmt::print("{:>10} {:>18} {:>20}\n", "entities", "vector (us/frame)", "registry (us/frame)");
+    for (size_t num_entities : {10, 100, 1000, 5000, 10000})
+    {
+        // The vector gets few frames at the larger sizes, it is quadratic per frame
+        const size_t num_frames = std::max<size_t>(200000 / num_entities, 10);
+        const double vector_us = run_frames<LinearRegistry>(num_entities, num_frames, checksum);
+        const double registry_us = run_frames<EntityHooksRegistry>(num_entities, num_frames, checksum);
+        fmt::print("{:>10} {:>18.2f} {:>20.2f}\n", num_entities, vector_us, registry_us);
+    }
+    fmt::print("(checksum {})\n", checksum);
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "entity_type_name_table.hpp"
+
+// Times to_id through the perfect hash table against the map lookup it replaced, on the ENT_TYPE names of the game
+// listed in docs/game_data/entities.txt, and checks that both resolve every name to the same id
+//
+// Usage: entity_type_name_bench [path/to/entities.txt]
+
+using clock_type = std::chrono::steady_clock;
+
+// What the call sites of to_id in the game do with a constant name
+ENT_TYPE cached_coffin_id(const EntityTypeNameTable& name_table)
+{
+    static const ENT_TYPE id = name_table.find("ENT_TYPE_ITEM_COFFIN"_ent_type).value_or(0);
+    return id;
+}
+
+template <class Fun>
+double time_lookups(size_t num_lookups, Fun&& fun)
+{
+    const auto start = clock_type::now();
+    fun();
+    const auto duration = std::chrono::duration<double, std::nano>(clock_type::now() - start);
+    return duration.count() / static_cast<double>(num_lookups);
+}
+
+int main(int argc, char** argv)
+{
+    const char* entities_path = argc > 1 ? argv[1] : SPEL2_ENTITIES_TXT;
+    std::ifstream entities_file{entities_path};
+    if (!entities_file)
+    {
+        fmt::print("Could not open {}\n", entities_path);
+        return 1;
+    }
+
+    // Every line looks like "1: ENT_TYPE_FLOOR_BORDERTILE"
+    EntityMap map;
+    std::string line;
+    while (std::getline(entities_file, line))
+    {
+        const size_t separator = line.find(": ");
+        if (separator != std::string::npos)
+        {
+            map[line.substr(separator + 2)] = static_cast<uint16_t>(std::stoul(line.substr(0, separator)));
+        }
+    }
+
+    const EntityTypeNameTable name_table{map};
+
+    size_t num_mismatches = 0;
+    for (auto& [name, id] : map)
+    {
+        if (name_table.find(name, hash_entity_type_name(name)) != ENT_TYPE{id})
+        {
+            fmt::print("MISMATCH {}: table does not return {}\n", name, id);
+            num_mismatches++;
+        }
+    }
+    for (std::string_view name : {"", "ENT_TYPE_", "ENT_TYPE_FLOOR_BORDERTILE_", "ent_type_floor_bordertile", "ENT_TYPE_NOT_A_TYPE"})
+    {
+        if (name_table.find(name, hash_entity_type_name(name)).has_value())
+        {
+            fmt::print("MISMATCH '{}': table returns an id for an unknown name\n", name);
+            num_mismatches++;
+        }
+    }
+
+    // Lookups are done in a random order so the map does not get to walk its buckets in memory order
+    std::vector<std::string_view> names;
+    for (auto& [name, id] : map)
+    {
+        names.push_back(name);
+    }
+    std::shuffle(names.begin(), names.end(), std::mt19937{1234});
+    std::vector<HashedEntityTypeName> hashed_names;
+    for (std::string_view name : names)
+    {
+        hashed_names.push_back({name, hash_entity_type_name(name)});
+    }
+
+    constexpr size_t num_rounds = 2000;
+    const size_t num_lookups = num_rounds * names.size();
+    uint64_t checksum = 0;
+
+    // The old to_id, a std::string is built for every lookup
+    const double map_ns = time_lookups(num_lookups, [&]()
+                                       {
+        for (size_t round = 0; round < num_rounds; round++)
+            for (std::string_view name : names)
+            {
+                auto it = map.find(std::string(name));
+                checksum += it != map.end() ? it->second : 0;
+            } });
+    // to_id(std::string_view), the name is hashed for every lookup
+    const double table_ns = time_lookups(num_lookups, [&]()
+                                         {
+        for (size_t round = 0; round < num_rounds; round++)
+            for (std::string_view name : names)
+                checksum += name_table.find(name, hash_entity_type_name(name)).value_or(0); });
+    // to_id("..."_ent_type), the hash is a compile time constant
+    const double literal_ns = time_lookups(num_lookups, [&]()
+                                           {
+        for (size_t round = 0; round < num_rounds; round++)
+            for (const HashedEntityTypeName& name : hashed_names)
+                checksum += name_table.find(name).value_or(0); });
+    // static const ENT_TYPE id = to_id("..."_ent_type), called through a pointer so the compiler can't hoist it
+    ENT_TYPE (*volatile cached_id)(const EntityTypeNameTable&) = cached_coffin_id;
+    const double cached_ns = time_lookups(num_lookups, [&]()
+                                          {
+        for (size_t i = 0; i < num_lookups; i++)
+            checksum += cached_id(name_table); });
+    if (cached_id(name_table) != name_table.find("ENT_TYPE_ITEM_COFFIN"_ent_type))
+    {
+        fmt::print("MISMATCH ENT_TYPE_ITEM_COFFIN: cached id differs from the table\n");
+        num_mismatches++;
+    }
+
+    fmt::print("{} names, {} lookups per variant (checksum {})\n", names.size(), num_lookups, checksum);
+    fmt::print("{:<32} {:>10}\n", "variant", "ns/lookup");
+    fmt::print("{:<32} {:>10.2f}\n", "EntityMap::find(std::string)", map_ns);
+    fmt::print("{:<32} {:>10.2f}\n", "table, hashed at runtime", table_ns);
+    fmt::print("{:<32} {:>10.2f}\n", "table, _ent_type literal", literal_ns);
+    fmt::print("{:<32} {:>10.2f}\n", "function-local static", cached_ns);
+
+    return num_mismatches == 0 ? 0 : 1;
+}
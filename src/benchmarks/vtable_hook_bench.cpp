@@ -0,0 +1,383 @@
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "vtable_hook.hpp"
+
+// Checks FlatPointerMap and the VTableDetour dispatch built on it, then times calls through an unhooked vtable against
+// calls through the detour with and without a hook on the object
+// The vtables are plain arrays owned by this program, so the vtable patching of vtable_hook.cpp is replaced by the
+// bookkeeping below
+//
+// Usage: vtable_hook_bench
+
+using clock_type = std::chrono::steady_clock;
+
+std::map<std::pair<void**, size_t>, void*> g_original_functions;
+
+void* register_hook_function(void*** vtable, size_t index, void* hook_function)
+{
+    auto [it, inserted] = g_original_functions.try_emplace({*vtable, index}, (*vtable)[index]);
+    (*vtable)[index] = hook_function;
+    return it->second;
+}
+void unregister_hook_function(void*** vtable, size_t index)
+{
+    if (auto it = g_original_functions.find({*vtable, index}); it != g_original_functions.end())
+    {
+        (*vtable)[index] = it->second;
+        g_original_functions.erase(it);
+    }
+}
+void* get_hook_function(void*** vtable, size_t index)
+{
+    auto it = g_original_functions.find({*vtable, index});
+    return it != g_original_functions.end() ? it->second : nullptr;
+}
+
+struct Object
+{
+    void** vtable;
+    int value;
+};
+using DtorFunT = void(void*, bool);
+using GetValueFunT = int(Object*, int);
+
+void object_dtor(void* self, bool destroy)
+{
+    if (destroy)
+    {
+        delete static_cast<Object*>(self);
+    }
+}
+int object_get_value(Object* self, int offset)
+{
+    return self->value + offset;
+}
+// Same signature as get_value in another slot
+int object_get_scaled_value(Object* self, int factor)
+{
+    return self->value * factor;
+}
+
+constexpr size_t dtor_index = 0;
+constexpr size_t get_value_index = 1;
+constexpr size_t get_scaled_value_index = 2;
+
+// Every vtable is only hooked by one test, since the detours keep the originals for the rest of the program
+struct VTable
+{
+    void* functions[3]{(void*)&object_dtor, (void*)&object_get_value, (void*)&object_get_scaled_value};
+
+    Object* make_object(int value)
+    {
+        return new Object{functions, value};
+    }
+};
+
+int call_get_value(Object* obj, int offset)
+{
+    return reinterpret_cast<GetValueFunT*>(obj->vtable[get_value_index])(obj, offset);
+}
+int call_get_scaled_value(Object* obj, int factor)
+{
+    return reinterpret_cast<GetValueFunT*>(obj->vtable[get_scaled_value_index])(obj, factor);
+}
+void destroy(Object* obj)
+{
+    reinterpret_cast<DtorFunT*>(obj->vtable[dtor_index])(obj, true);
+}
+
+size_t g_num_failures = 0;
+void check(bool condition, std::string_view what)
+{
+    if (!condition)
+    {
+        fmt::print("FAILED: {}\n", what);
+        g_num_failures++;
+    }
+}
+
+// Same as FlatPointerMap::slot_of, used to pick keys that collide
+size_t home_slot(uintptr_t key, size_t mask)
+{
+    return static_cast<size_t>((key >> 4) * 0x9e3779b97f4a7c15ull) & mask;
+}
+void* fake_key(uintptr_t i)
+{
+    return reinterpret_cast<void*>(i << 4);
+}
+
+void check_erase_wrap_around()
+{
+    // The first insert grows the map to 16 slots, it grows again at the 9th key
+    constexpr size_t mask = 15;
+    std::vector<void*> last_slot_keys;
+    std::vector<void*> first_slot_keys;
+    for (uintptr_t i = 1; last_slot_keys.size() < 3 || first_slot_keys.size() < 2; i++)
+    {
+        const size_t home = home_slot(i << 4, mask);
+        if (home == mask && last_slot_keys.size() < 3)
+            last_slot_keys.push_back(fake_key(i));
+        else if (home == 0 && first_slot_keys.size() < 2)
+            first_slot_keys.push_back(fake_key(i));
+    }
+
+    // Lands in slots 15, 0, 1, 2 and 3, the runs of both home slots wrap around the end of the array
+    FlatPointerMap<void, int> map;
+    int value = 0;
+    for (void* key : last_slot_keys)
+        map[key] = value++;
+    for (void* key : first_slot_keys)
+        map[key] = value++;
+
+    // Erasing slot 15 has to shift every entry of the run back across the end, the ones at home in slot 0 included
+    map.erase(last_slot_keys[0]);
+    check(map.find(last_slot_keys[0]) == nullptr, "erased key is still found after a wrapping erase");
+    for (size_t i = 1; i < last_slot_keys.size(); i++)
+        check(map.find(last_slot_keys[i]) != nullptr && *map.find(last_slot_keys[i]) == static_cast<int>(i), "key is lost after a wrapping erase");
+    for (size_t i = 0; i < first_slot_keys.size(); i++)
+        check(map.find(first_slot_keys[i]) != nullptr && *map.find(first_slot_keys[i]) == static_cast<int>(3 + i), "key at home in slot 0 is lost after a wrapping erase");
+
+    // Erasing in slot 0 must not pull an entry at home in slot 0 back into slot 15
+    map.erase(last_slot_keys[1]);
+    map.erase(last_slot_keys[2]);
+    for (size_t i = 0; i < first_slot_keys.size(); i++)
+        check(map.find(first_slot_keys[i]) != nullptr && *map.find(first_slot_keys[i]) == static_cast<int>(3 + i), "key at home in slot 0 is lost after erasing the wrapped run");
+    map.erase(first_slot_keys[0]);
+    map.erase(first_slot_keys[1]);
+    for (void* key : first_slot_keys)
+        check(map.find(key) == nullptr, "map is not empty after erasing every key");
+}
+
+void check_against_unordered_map()
+{
+    // Few distinct keys so the map keeps growing and shrinking through long colliding runs, erases happen between
+    // inserts that grow the map
+    std::mt19937 rng{1234};
+    FlatPointerMap<void, int> map;
+    std::unordered_map<void*, int> expected;
+    for (int step = 0; step < 200000; step++)
+    {
+        void* key = fake_key(1 + rng() % 96);
+        switch (rng() % 3)
+        {
+        case 0:
+        case 1:
+            map[key] = step;
+            expected[key] = step;
+            break;
+        case 2:
+            map.erase(key);
+            expected.erase(key);
+            break;
+        }
+        if (step % 64 == 0)
+        {
+            for (uintptr_t i = 1; i <= 96; i++)
+            {
+                auto it = expected.find(fake_key(i));
+                int* value = map.find(fake_key(i));
+                if ((it == expected.end()) != (value == nullptr) || (value != nullptr && *value != it->second))
+                {
+                    check(false, "FlatPointerMap differs from std::unordered_map");
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void check_grow_while_erasing()
+{
+    // The dtor task of the first object hooks many others, which grows s_Tasks and s_Functions in the middle of the dtor
+    // detour erasing the entries of the first object
+    static VTable vtable;
+    static std::vector<Object*> others;
+    static int num_dtor_calls = 0;
+
+    Object* first = vtable.make_object(1);
+    for (int i = 0; i < 500; i++)
+        others.push_back(vtable.make_object(100 + i));
+    hook_vtable<GetValueFunT, get_value_index>(
+        first, [](Object* self, int offset, GetValueFunT* original)
+        { return original(self, offset) * 2; });
+    hook_dtor(first, [](void*)
+              {
+                  num_dtor_calls++;
+                  for (Object* other : others)
+                  {
+                      hook_vtable<GetValueFunT, get_value_index>(
+                          other, [](Object* self, int offset, GetValueFunT* original)
+                          { return -original(self, offset); });
+                      hook_dtor(other, [](void*)
+                                { num_dtor_calls++; });
+                  } });
+    check(call_get_value(first, 1) == 4, "hook_vtable hook is not called");
+
+    destroy(first);
+    check(num_dtor_calls == 1, "dtor task of the first object did not run exactly once");
+    check(VTableDetour<GetValueFunT, get_value_index>::s_Functions.find(first) == nullptr, "hook of a destroyed object is left behind");
+    for (int i = 0; i < 500; i++)
+        check(call_get_value(others[i], 0) == -(100 + i), "hook added during a dtor task is lost");
+
+    for (Object* other : others)
+        destroy(other);
+    check(num_dtor_calls == 501, "dtor tasks added during a dtor task did not run");
+    for (Object* other : others)
+        check(VDestructorDetour::s_Tasks.find(other) == nullptr, "dtor tasks of a destroyed object are left behind");
+}
+
+void check_hook_rehooking_itself()
+{
+    // The running hook replaces itself and hooks enough other objects to grow s_Functions, the copy that is running
+    // must stay intact and the next call has to go to the new hook, the hooks carry a capture to notice if it doesn't
+    // There are more objects than check_grow_while_erasing left room for in s_Functions
+    static VTable vtable;
+    static Object* self_hooked = vtable.make_object(10);
+    static std::vector<Object*> others;
+    for (int i = 0; i < 2000; i++)
+        others.push_back(vtable.make_object(i));
+
+    int bonus = 7;
+    hook_vtable<GetValueFunT, get_value_index>(
+        self_hooked, [bonus](Object* self, int offset, GetValueFunT* original)
+        {
+            int new_bonus = 1000;
+            hook_vtable<GetValueFunT, get_value_index>(
+                self, [new_bonus](Object* inner_self, int inner_offset, GetValueFunT* inner_original)
+                { return inner_original(inner_self, inner_offset) + new_bonus; });
+            for (Object* other : others)
+                hook_vtable<GetValueFunT, get_value_index>(
+                    other, [](Object* other_self, int other_offset, GetValueFunT* other_original)
+                    { return other_original(other_self, other_offset) + 1; });
+            return original(self, offset) + bonus;
+        });
+
+    check(call_get_value(self_hooked, 5) == 22, "hook that rehooks itself returns the wrong value");
+    check(call_get_value(self_hooked, 5) == 1015, "hook set by a running hook is not used");
+    for (int i = 0; i < 2000; i++)
+        check(call_get_value(others[i], 0) == i + 1, "hook added by a running hook is lost");
+
+    destroy(self_hooked);
+    for (Object* other : others)
+        destroy(other);
+}
+
+void check_same_signature_slots()
+{
+    // Two slots of one vtable with the same signature, each has to keep its own original and its own hooks, for single
+    // objects as well as for the whole vtable
+    static VTable vtable;
+    Object* hooked = vtable.make_object(3);
+    Object* other = vtable.make_object(5);
+
+    hook_vtable<GetValueFunT, get_value_index>(
+        hooked, [](Object* self, int offset, GetValueFunT* original)
+        { return original(self, offset) + 100; });
+    hook_vtable<GetValueFunT, get_scaled_value_index>(
+        hooked, [](Object* self, int factor, GetValueFunT* original)
+        { return original(self, factor) + 1000; });
+    check(call_get_value(hooked, 1) == 104, "hook of the first slot calls the wrong original or hook");
+    check(call_get_scaled_value(hooked, 2) == 1006, "hook of the second slot calls the wrong original or hook");
+
+    hook_vtable_for_all<GetValueFunT, get_scaled_value_index>(
+        other, [](Object* self, int factor, GetValueFunT* original)
+        { return -original(self, factor); });
+    check(call_get_value(other, 1) == 6, "hook_vtable_for_all on the second slot changes the first slot");
+    check(call_get_scaled_value(other, 2) == -10, "hook_vtable_for_all on the second slot is not called");
+    check(call_get_scaled_value(hooked, 2) == 1006, "hook_vtable_for_all replaces the hook of an object");
+
+    destroy(hooked);
+    destroy(other);
+}
+
+template <class Fun>
+double time_calls(size_t num_calls, Fun&& fun)
+{
+    const auto start = clock_type::now();
+    fun();
+    const auto duration = std::chrono::duration<double, std::nano>(clock_type::now() - start);
+    return duration.count() / static_cast<double>(num_calls);
+}
+
+void bench_dispatch()
+{
+    constexpr size_t num_objects = 1000;
+    constexpr size_t num_rounds = 10000;
+    constexpr size_t num_calls = num_objects * num_rounds;
+
+    // Like a statemachine hook on some of the monsters of a level, the calls go over all objects of the vtable
+    static VTable unhooked_vtable;
+    static VTable hooked_vtable;
+    static VTable hooked_for_all_vtable;
+    std::vector<Object*> unhooked_objects;
+    std::vector<Object*> passthrough_objects;
+    std::vector<Object*> hooked_objects;
+    std::vector<Object*> hooked_for_all_objects;
+    for (int i = 0; i < static_cast<int>(num_objects); i++)
+    {
+        unhooked_objects.push_back(unhooked_vtable.make_object(i));
+        passthrough_objects.push_back(hooked_vtable.make_object(i));
+        hooked_objects.push_back(hooked_vtable.make_object(i));
+        hooked_for_all_objects.push_back(hooked_for_all_vtable.make_object(i));
+    }
+    for (Object* obj : hooked_objects)
+    {
+        hook_vtable<GetValueFunT, get_value_index>(
+            obj, [](Object* self, int offset, GetValueFunT* original)
+            { return original(self, offset) + 1; });
+    }
+    hook_vtable_for_all<GetValueFunT, get_value_index>(
+        hooked_for_all_objects[0], [](Object* self, int offset, GetValueFunT* original)
+        { return original(self, offset) + 1; });
+
+    int64_t checksum = 0;
+    auto time_objects = [&](const std::vector<Object*>& objects)
+    {
+        return time_calls(num_calls, [&]()
+                          {
+            for (size_t round = 0; round < num_rounds; round++)
+                for (Object* obj : objects)
+                    checksum += call_get_value(obj, static_cast<int>(round)); });
+    };
+    const double unhooked_ns = time_objects(unhooked_objects);
+    const double passthrough_ns = time_objects(passthrough_objects);
+    const double hooked_ns = time_objects(hooked_objects);
+    const double hooked_for_all_ns = time_objects(hooked_for_all_objects);
+
+    fmt::print("{} objects, {} calls per variant (checksum {})\n", num_objects, num_calls, checksum);
+    fmt::print("{:<40} {:>10}\n", "variant", "ns/call");
+    fmt::print("{:<40} {:>10.2f}\n", "vtable not hooked", unhooked_ns);
+    fmt::print("{:<40} {:>10.2f}\n", "vtable hooked, object not hooked", passthrough_ns);
+    fmt::print("{:<40} {:>10.2f}\n", "object hooked with hook_vtable", hooked_ns);
+    fmt::print("{:<40} {:>10.2f}\n", "vtable hooked with hook_vtable_for_all", hooked_for_all_ns);
+
+    for (const auto* objects : {&unhooked_objects, &passthrough_objects, &hooked_objects, &hooked_for_all_objects})
+        for (Object* obj : *objects)
+            destroy(obj);
+}
+
+int main()
+{
+    check_erase_wrap_around();
+    check_against_unordered_map();
+    check_grow_while_erasing();
+    check_hook_rehooking_itself();
+    check_same_signature_slots();
+    if (g_num_failures != 0)
+    {
+        return 1;
+    }
+    fmt::print("All checks passed\n");
+
+    bench_dispatch();
+    return 0;
+}
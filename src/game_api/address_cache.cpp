@@ -0,0 +1,97 @@
+#include "address_cache.hpp"
+
+#include <fstream>
+
+namespace
+{
+constexpr uint32_t address_cache_magic = 0x43414c4f; // "OLAC"
+constexpr uint32_t address_cache_format = 1;
+// Name size, exe_relative and value of an entry with an empty name
+constexpr size_t address_cache_min_entry_size = sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint64_t);
+
+template <class T>
+bool read_value(std::ifstream& file, T& value)
+{
+    return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+template <class T>
+void write_value(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+} // namespace
+
+std::optional<std::vector<AddressCacheEntry>> read_address_cache(std::string_view path, uint64_t fingerprint)
+{
+    std::ifstream file{std::string{path}, std::ios::binary};
+    if (!file)
+    {
+        return std::nullopt;
+    }
+
+    uint32_t magic{};
+    uint32_t format{};
+    uint64_t file_fingerprint{};
+    uint32_t num_entries{};
+    if (!read_value(file, magic) || !read_value(file, format) || !read_value(file, file_fingerprint) || !read_value(file, num_entries))
+    {
+        return std::nullopt;
+    }
+    if (magic != address_cache_magic || format != address_cache_format || file_fingerprint != fingerprint)
+    {
+        return std::nullopt;
+    }
+
+    // The count comes from disk, so a corrupt file must not make us reserve more entries than the file can hold
+    const std::streampos entries_begin = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff entries_size = file.tellg() - entries_begin;
+    file.seekg(entries_begin);
+    if (!file || entries_size < 0 || (uint64_t)num_entries * address_cache_min_entry_size > (uint64_t)entries_size)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<AddressCacheEntry> entries;
+    entries.reserve(num_entries);
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        uint16_t name_size{};
+        if (!read_value(file, name_size))
+        {
+            return std::nullopt;
+        }
+
+        AddressCacheEntry& entry = entries.emplace_back();
+        entry.name.resize(name_size);
+        uint8_t exe_relative{};
+        if (!file.read(entry.name.data(), name_size) || !read_value(file, exe_relative) || !read_value(file, entry.value))
+        {
+            return std::nullopt;
+        }
+        entry.exe_relative = exe_relative != 0;
+    }
+    return entries;
+}
+
+bool write_address_cache(std::string_view path, uint64_t fingerprint, const std::vector<AddressCacheEntry>& entries)
+{
+    std::ofstream file{std::string{path}, std::ios::binary | std::ios::trunc};
+    if (!file)
+    {
+        return false;
+    }
+
+    write_value(file, address_cache_magic);
+    write_value(file, address_cache_format);
+    write_value(file, fingerprint);
+    write_value(file, (uint32_t)entries.size());
+    for (const AddressCacheEntry& entry : entries)
+    {
+        write_value(file, (uint16_t)entry.name.size());
+        file.write(entry.name.data(), entry.name.size());
+        write_value(file, (uint8_t)entry.exe_relative);
+        write_value(file, entry.value);
+    }
+    return (bool)file;
+}
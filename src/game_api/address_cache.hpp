@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// On-disk cache of resolved addresses, lets preload_addresses skip all pattern searches as long as neither the game
+// executable nor the address rules changed since the cache was written
+struct AddressCacheEntry
+{
+    std::string name;
+    // Addresses inside the executable are stored as offsets to its base since the base changes every launch
+    bool exe_relative;
+    uint64_t value;
+};
+
+// FNV-1a, used to build the fingerprint that keys the cache
+inline uint64_t fingerprint_bytes(uint64_t hash, std::string_view bytes)
+{
+    for (char c : bytes)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+template <class T>
+requires std::is_trivially_copyable_v<T>
+    uint64_t fingerprint_value(uint64_t hash, const T& value)
+{
+    return fingerprint_bytes(hash, std::string_view{reinterpret_cast<const char*>(&value), sizeof(value)});
+}
+constexpr uint64_t fingerprint_seed = 0xcbf29ce484222325ull;
+
+// Returns std::nullopt if the file does not exist, is corrupt or was written for a different fingerprint
+std::optional<std::vector<AddressCacheEntry>> read_address_cache(std::string_view path, uint64_t fingerprint);
+bool write_address_cache(std::string_view path, uint64_t fingerprint, const std::vector<AddressCacheEntry>& entries);
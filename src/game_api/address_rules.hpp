@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "address_cache.hpp"
+#include "virtual_table.hpp"
+
+using namespace std::string_view_literals;
+
+// Pushes of callee-saved registers that start the first function after the asset bundle
+inline constexpr std::string_view g_after_bundle_pattern = "\x55\x41\x57\x41\x56\x41\x55\x41\x54"sv;
+
+// The game bundles its assets at the start of the image, returns the offset right after them so pattern searches can
+// skip the bundle
+size_t bundle_end(const char* exe);
+
+// The executable the address rules run against, this is either the running game or an image mapped from disk
+// The image has to be laid out like it is when loaded, i.e. every section is at its virtual address
+struct AddressRuleContext
+{
+    const char* exe;
+    size_t after_bundle;
+    size_t code_end;
+
+    // Resolves another rule, used by PatternCommandBuffer::get_address
+    std::function<size_t(std::string_view address_name)> get_address;
+    // Returns the offset of a virtual function, used by PatternCommandBuffer::get_virtual_function_address
+    std::function<size_t(VTABLE_OFFSET table_offset, uint32_t function_index)> get_virtual_function_address;
+    // Searches the pattern in [start, end), returning std::nullopt makes the rule return 0
+    std::function<std::optional<size_t>(std::string_view pattern, size_t start, size_t end, std::string_view address_name, bool is_required)> find_inst;
+};
+
+class PatternCommandBuffer
+{
+  public:
+    PatternCommandBuffer() = default;
+    PatternCommandBuffer(const PatternCommandBuffer&) = default;
+    PatternCommandBuffer(PatternCommandBuffer&&) noexcept = default;
+    PatternCommandBuffer& operator=(const PatternCommandBuffer&) = default;
+    PatternCommandBuffer& operator=(PatternCommandBuffer&&) noexcept = default;
+
+    PatternCommandBuffer& set_optional(bool optional)
+    {
+        commands.push_back({CommandType::SetOptional, {.optional = optional}});
+        return *this;
+    }
+    PatternCommandBuffer& get_address(std::string_view address_name)
+    {
+        commands.push_back({CommandType::GetAddress, {.address_name = address_name}});
+        return *this;
+    }
+    PatternCommandBuffer& get_virtual_function_address(VTABLE_OFFSET table_offset, VIRT_FUNC function_index)
+    {
+        commands.push_back({CommandType::GetVirtualFunctionAddress, {.get_vfunc_addr_args = {.table_offset = table_offset, .function_index = function_index}}});
+        return *this;
+    }
+    PatternCommandBuffer& find_inst(std::string_view pattern)
+    {
+        commands.push_back({CommandType::FindInst, {.find_inst_args = {pattern}}});
+        return *this;
+    }
+    PatternCommandBuffer& find_after_inst(std::string_view pattern)
+    {
+        return find_inst(pattern).offset(pattern.size());
+    }
+    PatternCommandBuffer& find_next_inst(std::string_view pattern)
+    {
+        return offset(0x1).find_inst(pattern);
+    }
+    PatternCommandBuffer& find_inst_in_range(std::string_view pattern, size_t range)
+    {
+        commands.push_back({CommandType::FindInst, {.find_inst_args = {.pattern = pattern, .range = range}}});
+        return *this;
+    }
+    PatternCommandBuffer& find_after_inst_in_range(std::string_view pattern, size_t range)
+    {
+        return find_inst_in_range(pattern, range).offset(pattern.size());
+    }
+    PatternCommandBuffer& find_next_inst_in_range(std::string_view pattern, size_t range)
+    {
+        return offset(0x1).find_inst_in_range(pattern, range);
+    }
+    PatternCommandBuffer& offset(int64_t offset)
+    {
+        commands.push_back({CommandType::Offset, {.offset = offset}});
+        return *this;
+    }
+    PatternCommandBuffer& decode_pc(uint8_t opcode_prefix = 3, uint8_t opcode_suffix = 0, uint8_t opcode_addr = 4)
+    {
+        commands.push_back({CommandType::DecodePC, {.decode_pc_args = {opcode_prefix, opcode_suffix, opcode_addr}}});
+        return *this;
+    }
+    PatternCommandBuffer& decode_imm(uint8_t opcode_prefix = 3)
+    {
+        commands.push_back({CommandType::DecodeIMM, {.decode_imm_prefix = opcode_prefix}});
+        return *this;
+    }
+    PatternCommandBuffer& decode_call()
+    {
+        commands.push_back({CommandType::DecodeCall});
+        return *this;
+    }
+    PatternCommandBuffer& at_exe()
+    {
+        commands.push_back({CommandType::AtExe});
+        return *this;
+    }
+    PatternCommandBuffer& function_start()
+    {
+        commands.push_back({CommandType::FunctionStart});
+        return *this;
+    }
+
+    // Returns the pattern of the first find_inst if it searches the whole executable starting at after_bundle
+    // This lets preload_addresses search for the first pattern of all rules at once
+    std::optional<std::string_view> leading_pattern() const
+    {
+        for (auto& [command, data] : commands)
+        {
+            switch (command)
+            {
+            case CommandType::SetOptional:
+                continue;
+            case CommandType::FindInst:
+                if (data.find_inst_args.range.has_value())
+                {
+                    return std::nullopt;
+                }
+                return data.find_inst_args.pattern;
+            default:
+                return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Names of the addresses that have to be resolved before this rule can run
+    std::vector<std::string_view> dependencies() const
+    {
+        std::vector<std::string_view> address_names;
+        for (auto& [command, data] : commands)
+        {
+            if (command == CommandType::GetAddress)
+            {
+                address_names.push_back(data.address_name);
+            }
+            else if (command == CommandType::GetVirtualFunctionAddress)
+            {
+                address_names.push_back("virtual_functions_table"sv);
+            }
+        }
+        return address_names;
+    }
+
+    // Mixes every command of this rule into the hash, so the address cache is invalidated when the rule changes
+    uint64_t fingerprint(uint64_t hash) const
+    {
+        for (auto& [command, data] : commands)
+        {
+            hash = fingerprint_value(hash, command);
+            switch (command)
+            {
+            case CommandType::SetOptional:
+                hash = fingerprint_value(hash, data.optional);
+                break;
+            case CommandType::GetAddress:
+                hash = fingerprint_bytes(hash, data.address_name);
+                break;
+            case CommandType::GetVirtualFunctionAddress:
+                hash = fingerprint_value(hash, data.get_vfunc_addr_args);
+                break;
+            case CommandType::FindInst:
+                hash = fingerprint_bytes(hash, data.find_inst_args.pattern);
+                hash = fingerprint_value(hash, data.find_inst_args.range.value_or(0));
+                break;
+            case CommandType::Offset:
+                hash = fingerprint_value(hash, data.offset);
+                break;
+            case CommandType::DecodePC:
+                hash = fingerprint_value(hash, data.decode_pc_args);
+                break;
+            case CommandType::DecodeIMM:
+                hash = fingerprint_value(hash, data.decode_imm_prefix);
+                break;
+            default:
+                break;
+            }
+        }
+        return hash;
+    }
+
+    // Runs the rule against the executable described by context and returns the resolved address
+    // If leading_hit is set it is used as the result of the first find_inst, see leading_pattern
+    std::optional<size_t> operator()(const AddressRuleContext& context, std::string_view address_name, std::optional<size_t> leading_hit = std::nullopt) const;
+
+  private:
+    struct DecodePcArgs
+    {
+        uint8_t opcode_offset;
+        uint8_t opcode_suffix_offset;
+        uint8_t opcode_addr_size;
+
+        std::tuple<uint8_t, uint8_t, uint8_t> as_tuple() const
+        {
+            return {opcode_offset, opcode_suffix_offset, opcode_addr_size};
+        }
+    };
+    struct FindInstArgs
+    {
+        std::string_view pattern;
+        std::optional<size_t> range;
+    };
+    struct GetVirtualFunctionAddressArgs
+    {
+        VTABLE_OFFSET table_offset;
+        VIRT_FUNC function_index;
+    };
+
+    enum class CommandType
+    {
+        SetOptional,
+        GetAddress,
+        GetVirtualFunctionAddress,
+        FindInst,
+        Offset,
+        DecodePC,
+        DecodeIMM,
+        DecodeCall,
+        AtExe,
+        FunctionStart,
+    };
+    union CommandData
+    {
+        bool optional;
+        std::string_view address_name;
+        FindInstArgs find_inst_args;
+        int64_t offset;
+        DecodePcArgs decode_pc_args;
+        uint8_t decode_imm_prefix;
+        GetVirtualFunctionAddressArgs get_vfunc_addr_args;
+    };
+    struct Command
+    {
+        CommandType command;
+        CommandData data;
+    };
+    std::vector<Command> commands;
+};
+
+using AddressRule = PatternCommandBuffer;
+extern std::unordered_map<std::string_view, AddressRule> g_address_rules;
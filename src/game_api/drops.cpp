@@ -1,8 +1,11 @@
 #include "drops.hpp"
-#include "memory.hpp"
 #include "search.hpp"
 
+#ifdef PERFORM_DROPS_TEST
+#include "memory.hpp"
+
 #include <iostream>
+#endif
 
 using namespace std::string_literals;
 
@@ -6,6 +6,8 @@
 
 #include "character_def.hpp"
 #include "entities_items.hpp"
+#include "entity_index.hpp"
+#include "entity_type_name_table.hpp"
 #include "logger.h"
 #include "render_api.hpp"
 #include "rpc.hpp"
@@ -15,9 +17,8 @@
 #include "vtable_hook.hpp"
 
 using namespace std::chrono_literals;
-using EntityMap = std::unordered_map<std::string, uint16_t>;
 
-std::vector<EntityHooksInfo> g_entity_hooks;
+EntityHooksRegistry g_entity_hooks;
 
 struct EntityBucket
 {
@@ -84,16 +85,27 @@ EntityDB* get_type(uint32_t id)
     return entity_factory_ptr->types + id;
 }
 
-ENT_TYPE to_id(std::string_view name)
+ENT_TYPE to_id(HashedEntityTypeName name)
 {
     const EntityFactory* entity_factory_ptr = entity_factory();
     if (!entity_factory_ptr)
         return {};
     const EntityMap& map = entity_factory_ptr->entity_map;
-    auto it = map.find(std::string(name));
+
+    // The map is filled together with the factory and never changes, names that are missing from the table anyway are
+    // looked up in the map
+    static const EntityTypeNameTable name_table{map};
+    if (auto id = name_table.find(name.name, name.hash))
+        return id.value();
+    auto it = map.find(std::string(name.name));
     return it != map.end() ? it->second : -1;
 }
 
+ENT_TYPE to_id(std::string_view name)
+{
+    return to_id(HashedEntityTypeName{name, hash_entity_type_name(name)});
+}
+
 void Entity::teleport(float dx, float dy, bool s, float vx, float vy, bool snap)
 {
     if (overlay)
@@ -136,6 +148,7 @@ void Entity::teleport(float dx, float dy, bool s, float vx, float vy, bool snap)
         movable_ent->velocityx = vx;
         movable_ent->velocityy = vy;
     }
+    invalidate_entity_index();
     return;
 }
 
@@ -152,6 +165,7 @@ void Entity::teleport_abs(float dx, float dy, float vx, float vy)
         movable_ent->velocityx = vx;
         movable_ent->velocityy = vy;
     }
+    invalidate_entity_index();
 }
 
 void Entity::set_layer(LAYER layer_to)
@@ -207,6 +221,7 @@ void Entity::remove()
             }
         }
         layer = 2;
+        invalidate_entity_index();
     }
 }
 
@@ -341,34 +356,72 @@ bool Movable::is_button_released(BUTTON button)
     return (buttons & button) == 0 && (buttons_previous & button) == button;
 }
 
-void hook_movable_state_machine(Movable* _self)
+// Hooks shared by all entities of one type, indexed by the ENT_TYPE
+struct EntityTypeHooksInfo
 {
-    hook_vtable<void(Movable*)>(
-        _self,
-        [](Movable* self, void (*original)(Movable*))
-        {
-            EntityHooksInfo& hook_info = self->get_hooks();
+    std::vector<HookWithId<bool(Movable*)>> pre_statemachine;
+    std::vector<HookWithId<void(Movable*)>> post_statemachine;
+    void** hooked_vtable{nullptr};
+};
+std::array<EntityTypeHooksInfo, sizeof(EntityFactory::types) / sizeof(EntityDB)> g_entity_type_hooks;
+std::uint32_t g_entity_type_hooks_cbcount{0};
 
-            bool skip_orig = false;
-            for (auto& [id, pre] : hook_info.pre_statemachine)
-            {
-                if (pre(self))
-                {
-                    skip_orig = true;
-                }
-            }
+// Runs the type hooks and then the hooks of the entity itself, hook_info is nullptr if the entity has none
+void run_movable_state_machine(Movable* self, void (*original)(Movable*), EntityHooksInfo* hook_info)
+{
+    EntityTypeHooksInfo* type_hook_info = self->type->id < g_entity_type_hooks.size() ? &g_entity_type_hooks[self->type->id] : nullptr;
 
-            if (!skip_orig)
+    bool skip_orig = false;
+    if (type_hook_info)
+    {
+        for (auto& [id, pre] : type_hook_info->pre_statemachine)
+        {
+            if (pre(self))
             {
-                original(self);
+                skip_orig = true;
             }
-
-            for (auto& [id, post] : hook_info.post_statemachine)
+        }
+    }
+    if (hook_info)
+    {
+        for (auto& [id, pre] : hook_info->pre_statemachine)
+        {
+            if (pre(self))
             {
-                post(self);
+                skip_orig = true;
             }
-        },
-        0x2);
+        }
+    }
+
+    if (!skip_orig)
+    {
+        original(self);
+    }
+
+    if (type_hook_info)
+    {
+        for (auto& [id, post] : type_hook_info->post_statemachine)
+        {
+            post(self);
+        }
+    }
+    if (hook_info)
+    {
+        for (auto& [id, post] : hook_info->post_statemachine)
+        {
+            post(self);
+        }
+    }
+}
+
+void hook_movable_state_machine(Movable* _self)
+{
+    hook_vtable<void(Movable*), 0x2>(
+        _self,
+        [](Movable* self, void (*original)(Movable*))
+        {
+            run_movable_state_machine(self, original, &self->get_hooks());
+        });
 }
 void Movable::set_pre_statemachine(std::uint32_t reserved_callback_id, std::function<bool(Movable*)> pre_state_machine)
 {
@@ -389,6 +442,105 @@ void Movable::set_post_statemachine(std::uint32_t reserved_callback_id, std::fun
     hook_info.post_statemachine.push_back({reserved_callback_id, std::move(post_state_machine)});
 }
 
+void apply_entity_type_hooks(Entity* entity)
+{
+    if (entity == nullptr || entity->type->id >= g_entity_type_hooks.size())
+    {
+        return;
+    }
+    EntityTypeHooksInfo& type_hook_info = g_entity_type_hooks[entity->type->id];
+    if (type_hook_info.pre_statemachine.empty() && type_hook_info.post_statemachine.empty())
+    {
+        return;
+    }
+
+    // All entities of a type share their vtable, so this usually only hooks once per type
+    void** vtable = *(void***)entity;
+    if (type_hook_info.hooked_vtable != vtable && entity->is_movable())
+    {
+        hook_vtable_for_all<void(Movable*), 0x2>(
+            entity->as<Movable>(),
+            [](Movable* self, void (*original)(Movable*))
+            {
+                run_movable_state_machine(self, original, nullptr);
+            });
+        type_hook_info.hooked_vtable = vtable;
+    }
+}
+void apply_entity_type_hooks_to_existing(ENT_TYPE entity_type)
+{
+    for_each_entity_by(EntityTypeSet{entity_type}, 0, LAYER::BOTH, [](Entity* entity)
+                       { apply_entity_type_hooks(entity); });
+}
+
+std::uint32_t reserve_entity_type_hook_id()
+{
+    return ++g_entity_type_hooks_cbcount;
+}
+bool set_pre_statemachine_for_type(ENT_TYPE entity_type, std::uint32_t reserved_callback_id, std::function<bool(Movable*)> pre_state_machine)
+{
+    if (entity_type >= g_entity_type_hooks.size())
+    {
+        return false;
+    }
+    g_entity_type_hooks[entity_type].pre_statemachine.push_back({reserved_callback_id, std::move(pre_state_machine)});
+    apply_entity_type_hooks_to_existing(entity_type);
+    return true;
+}
+bool set_post_statemachine_for_type(ENT_TYPE entity_type, std::uint32_t reserved_callback_id, std::function<void(Movable*)> post_state_machine)
+{
+    if (entity_type >= g_entity_type_hooks.size())
+    {
+        return false;
+    }
+    g_entity_type_hooks[entity_type].post_statemachine.push_back({reserved_callback_id, std::move(post_state_machine)});
+    apply_entity_type_hooks_to_existing(entity_type);
+    return true;
+}
+void clear_entity_type_hook(ENT_TYPE entity_type, std::uint32_t id)
+{
+    if (entity_type < g_entity_type_hooks.size())
+    {
+        // The vtable stays hooked, without type hooks left its detour just calls the original
+        std::erase_if(g_entity_type_hooks[entity_type].pre_statemachine, [id](auto& hook)
+                      { return hook.id == id; });
+        std::erase_if(g_entity_type_hooks[entity_type].post_statemachine, [id](auto& hook)
+                      { return hook.id == id; });
+    }
+}
+
+std::pair<float, float> entity_render_position(Entity* ent)
+{
+    if (ent->rendering_info != nullptr && !ent->rendering_info->stop_render)
+        return {ent->rendering_info->x, ent->rendering_info->y};
+    return ent->position();
+}
+
+std::pair<float, float> entity_velocity(Entity* ent)
+{
+    float vx{0.0f};
+    float vy{0.0f};
+    if (ent->is_movable())
+    {
+        Movable* mov = ent->as<Movable>();
+        vx = mov->velocityx;
+        vy = mov->velocityy;
+    }
+    else if (ent->is_liquid())
+    {
+        auto liquid_engine = State::get().get_correct_liquid_engine(ent->type->id);
+        vx = liquid_engine->entity_velocities->first;
+        vy = liquid_engine->entity_velocities->second;
+    }
+    if (ent->overlay)
+    {
+        auto [ovx, ovy] = entity_velocity(ent->overlay);
+        vx += ovx;
+        vy += ovy;
+    }
+    return {vx, vy};
+}
+
 std::tuple<float, float, uint8_t> get_position(uint32_t uid)
 {
     Entity* ent = get_entity_ptr(uid);
@@ -403,10 +555,8 @@ std::tuple<float, float, uint8_t> get_render_position(uint32_t uid)
     Entity* ent = get_entity_ptr(uid);
     if (ent)
     {
-        if (ent->rendering_info != nullptr && !ent->rendering_info->stop_render)
-            return std::make_tuple(ent->rendering_info->x, ent->rendering_info->y, ent->layer);
-        else
-            return get_position(uid);
+        auto [x, y] = entity_render_position(ent);
+        return std::make_tuple(x, y, ent->layer);
     }
     return {0.0f, 0.0f, (uint8_t)0};
 }
@@ -415,26 +565,7 @@ std::tuple<float, float> get_velocity(uint32_t uid)
 {
     if (Entity* ent = get_entity_ptr(uid))
     {
-        float vx{0.0f};
-        float vy{0.0f};
-        if (ent->is_movable())
-        {
-            Movable* mov = ent->as<Movable>();
-            vx = mov->velocityx;
-            vy = mov->velocityy;
-        }
-        else if (ent->is_liquid())
-        {
-            auto liquid_engine = State::get().get_correct_liquid_engine(ent->type->id);
-            vx = liquid_engine->entity_velocities->first;
-            vy = liquid_engine->entity_velocities->second;
-        }
-        if (ent->overlay)
-        {
-            auto [ovx, ovy] = get_velocity(ent->overlay->uid);
-            vx += ovx;
-            vy += ovy;
-        }
+        auto [vx, vy] = entity_velocity(ent);
         return std::tuple{vx, vy};
     }
     return std::tuple{0.0f, 0.0f};
@@ -455,6 +586,58 @@ AABB get_hitbox(uint32_t uid, bool use_render_pos)
     return AABB{0.0f, 0.0f, 0.0f, 0.0f};
 }
 
+void EntityProperties::clear()
+{
+    uids.clear();
+    types.clear();
+    x.clear();
+    y.clear();
+    layers.clear();
+    velocity_x.clear();
+    velocity_y.clear();
+    hitboxes.clear();
+}
+void EntityProperties::push_back(uint32_t uid, Entity* ent, bool use_render_pos)
+{
+    uids.push_back(uid);
+    if (ent == nullptr)
+    {
+        types.push_back(0);
+        x.push_back(0.0f);
+        y.push_back(0.0f);
+        layers.push_back(0);
+        velocity_x.push_back(0.0f);
+        velocity_y.push_back(0.0f);
+        hitboxes.push_back(AABB{0.0f, 0.0f, 0.0f, 0.0f});
+        return;
+    }
+
+    // position() and the velocity both walk the overlay chain by pointer, no further uid lookups are needed
+    const auto [ex, ey] = use_render_pos ? entity_render_position(ent) : ent->position();
+    const auto [vx, vy] = entity_velocity(ent);
+    types.push_back(ent->type->id);
+    x.push_back(ex);
+    y.push_back(ey);
+    layers.push_back(ent->layer);
+    velocity_x.push_back(vx);
+    velocity_y.push_back(vy);
+    hitboxes.push_back(AABB{
+        ex - ent->hitboxx + ent->offsetx,
+        ey + ent->hitboxy + ent->offsety,
+        ex + ent->hitboxx + ent->offsetx,
+        ey - ent->hitboxy + ent->offsety,
+    });
+}
+
+void get_entity_properties(std::span<const uint32_t> uids, bool use_render_pos, EntityProperties& out)
+{
+    out.clear();
+    for (uint32_t uid : uids)
+    {
+        out.push_back(uid, get_entity_ptr(uid), use_render_pos);
+    }
+}
+
 TEXTURE Entity::get_texture()
 {
     return texture->id;
@@ -471,55 +654,40 @@ bool Entity::set_texture(TEXTURE texture_id)
 
 void Entity::unhook(std::uint32_t id)
 {
-    auto it = std::find_if(g_entity_hooks.begin(), g_entity_hooks.end(), [this](auto& hook)
-                           { return hook.entity == this; });
-    if (it != g_entity_hooks.end())
+    if (EntityHooksInfo* hook_info_ptr = g_entity_hooks.find(this))
     {
-        std::erase_if(it->on_dtor, [id](auto& hook)
+        EntityHooksInfo& hook_info = *hook_info_ptr;
+        std::erase_if(hook_info.on_dtor, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->on_destroy, [id](auto& hook)
+        std::erase_if(hook_info.on_destroy, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->on_kill, [id](auto& hook)
+        std::erase_if(hook_info.on_kill, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->on_player_instagib, [id](auto& hook)
+        std::erase_if(hook_info.on_player_instagib, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->on_damage, [id](auto& hook)
+        std::erase_if(hook_info.on_damage, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->pre_statemachine, [id](auto& hook)
+        std::erase_if(hook_info.pre_statemachine, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->post_statemachine, [id](auto& hook)
+        std::erase_if(hook_info.post_statemachine, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->on_open, [id](auto& hook)
+        std::erase_if(hook_info.on_open, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->pre_collision1, [id](auto& hook)
+        std::erase_if(hook_info.pre_collision1, [id](auto& hook)
                       { return hook.id == id; });
-        std::erase_if(it->pre_collision2, [id](auto& hook)
+        std::erase_if(hook_info.pre_collision2, [id](auto& hook)
                       { return hook.id == id; });
     }
 }
 EntityHooksInfo& Entity::get_hooks()
 {
-    auto it = std::find_if(g_entity_hooks.begin(), g_entity_hooks.end(), [this](auto& hook)
-                           { return hook.entity == this; });
-    if (it == g_entity_hooks.end())
+    auto [hook_info, inserted] = g_entity_hooks.get_or_add(this);
+    if (inserted)
     {
         hook_dtor(this, [](void* self)
-                  {
-                      auto _it = std::find_if(g_entity_hooks.begin(), g_entity_hooks.end(), [self](auto& hook)
-                                              { return hook.entity == self; });
-                      if (_it != g_entity_hooks.end())
-                      {
-                          for (auto& cb : _it->on_dtor)
-                          {
-                              cb.fun((Entity*)self);
-                          }
-                          g_entity_hooks.erase(_it);
-                      }
-                  });
-        g_entity_hooks.push_back({this});
-        return g_entity_hooks.back();
-    }
-    return *it;
+                  { g_entity_hooks.on_dtor(self); });
+    }
+    return hook_info;
 }
 
 std::uint32_t Entity::set_on_dtor(std::function<void(Entity*)> cb)
@@ -538,7 +706,7 @@ void Entity::set_on_destroy(std::uint32_t reserved_callback_id, std::function<vo
     EntityHooksInfo& hook_info = get_hooks();
     if (hook_info.on_destroy.empty())
     {
-        hook_vtable<void(Entity*)>(
+        hook_vtable<void(Entity*), 0x5>(
             this,
             [](Entity* self, void (*original)(Entity*))
             {
@@ -548,8 +716,7 @@ void Entity::set_on_destroy(std::uint32_t reserved_callback_id, std::function<vo
                     on_destroy(self);
                 }
                 original(self);
-            },
-            0x5);
+            });
     }
     hook_info.on_destroy.push_back({reserved_callback_id, std::move(on_destroy)});
 }
@@ -558,7 +725,7 @@ void Entity::set_on_kill(std::uint32_t reserved_callback_id, std::function<void(
     EntityHooksInfo& hook_info = get_hooks();
     if (hook_info.on_kill.empty())
     {
-        hook_vtable<void(Entity*, bool, Entity*)>(
+        hook_vtable<void(Entity*, bool, Entity*), 0x3>(
             this,
             [](Entity* self, bool _some_bool, Entity* from, void (*original)(Entity*, bool, Entity*))
             {
@@ -568,8 +735,7 @@ void Entity::set_on_kill(std::uint32_t reserved_callback_id, std::function<void(
                     on_kill(self, from);
                 }
                 original(self, _some_bool, from);
-            },
-            0x3);
+            });
     }
     hook_info.on_kill.push_back({reserved_callback_id, std::move(on_kill)});
 }
@@ -593,7 +759,7 @@ void Entity::set_on_damage(std::uint32_t reserved_callback_id, std::function<boo
         }
         else
         {
-            hook_vtable<void(Entity*, Entity*, int8_t, uint32_t, float*, float*, uint16_t, uint8_t)>(
+            hook_vtable<void(Entity*, Entity*, int8_t, uint32_t, float*, float*, uint16_t, uint8_t), 0x30>(
                 this,
                 [](Entity* self, Entity* damage_dealer, int8_t damage_amount, uint32_t unknown1, float* velocities, float* unknown2, uint16_t stun_amount, uint8_t iframes, void (*original)(Entity*, Entity*, int8_t, uint32_t, float*, float*, uint16_t, uint8_t))
                 {
@@ -611,8 +777,7 @@ void Entity::set_on_damage(std::uint32_t reserved_callback_id, std::function<boo
                     {
                         original(self, damage_dealer, damage_amount, unknown1, velocities, unknown2, stun_amount, iframes);
                     }
-                },
-                0x30);
+                });
         }
     }
     hook_info.on_damage.push_back({reserved_callback_id, std::move(on_damage)});
@@ -649,7 +814,7 @@ void Container::set_on_open(std::uint32_t reserved_callback_id, std::function<vo
     EntityHooksInfo& hook_info = get_hooks();
     if (hook_info.on_open.empty())
     {
-        hook_vtable<void(Container*, Movable*)>(
+        hook_vtable<void(Container*, Movable*), 0x18>(
             this,
             [](Container* self, Movable* opener, void (*original)(Container*, Movable*))
             {
@@ -662,8 +827,7 @@ void Container::set_on_open(std::uint32_t reserved_callback_id, std::function<vo
                     }
                 }
                 original(self, opener);
-            },
-            0x18);
+            });
     }
     hook_info.on_open.push_back({reserved_callback_id, std::move(on_open)});
 }
@@ -673,7 +837,7 @@ void Entity::set_pre_collision1(std::uint32_t reserved_callback_id, std::functio
     EntityHooksInfo& hook_info = get_hooks();
     if (hook_info.pre_collision1.empty())
     {
-        hook_vtable<void(Entity*, Entity*)>(
+        hook_vtable<void(Entity*, Entity*), 0x4>(
             this,
             [](Entity* self, Entity* collision_entity, void (*original)(Entity*, Entity*))
             {
@@ -692,8 +856,7 @@ void Entity::set_pre_collision1(std::uint32_t reserved_callback_id, std::functio
                 {
                     original(self, collision_entity);
                 }
-            },
-            0x4);
+            });
     }
     hook_info.pre_collision1.push_back({reserved_callback_id, std::move(pre_collision1)});
 }
@@ -703,7 +866,7 @@ void Entity::set_pre_collision2(std::uint32_t reserved_callback_id, std::functio
     EntityHooksInfo& hook_info = get_hooks();
     if (hook_info.pre_collision2.empty())
     {
-        hook_vtable<void(Entity*, Entity*)>(
+        hook_vtable<void(Entity*, Entity*), 0x1A>(
             this,
             [](Entity* self, Entity* collision_entity, void (*original)(Entity*, Entity*))
             {
@@ -722,8 +885,7 @@ void Entity::set_pre_collision2(std::uint32_t reserved_callback_id, std::functio
                 {
                     original(self, collision_entity);
                 }
-            },
-            0x1A);
+            });
     }
     hook_info.pre_collision2.push_back({reserved_callback_id, std::move(pre_collision2)});
 }
@@ -3,6 +3,7 @@
 #include <array>
 #include <functional>
 #include <map>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -10,6 +11,8 @@
 
 #include "aliases.hpp"
 #include "color.hpp"
+#include "entity_hooks_registry.hpp"
+#include "entity_type_name_table.hpp"
 #include "math.hpp"
 #include "memory.hpp"
 #include "state_structs.hpp"
@@ -45,28 +48,6 @@ class Entity;
 class Movable;
 class Container;
 
-template <class FunT>
-struct HookWithId
-{
-    std::uint32_t id;
-    std::function<FunT> fun;
-};
-struct EntityHooksInfo
-{
-    void* entity;
-    std::uint32_t cbcount;
-    std::vector<HookWithId<void(Entity*)>> on_dtor;
-    std::vector<HookWithId<void(Entity*)>> on_destroy;
-    std::vector<HookWithId<void(Entity*, Entity*)>> on_kill;
-    std::vector<HookWithId<bool(Entity*)>> on_player_instagib;
-    std::vector<HookWithId<bool(Entity*, Entity*, int8_t, float, float, uint16_t, uint8_t)>> on_damage;
-    std::vector<HookWithId<bool(Movable*)>> pre_statemachine;
-    std::vector<HookWithId<void(Movable*)>> post_statemachine;
-    std::vector<HookWithId<void(Container*, Movable*)>> on_open;
-    std::vector<HookWithId<bool(Entity*, Entity*)>> pre_collision1;
-    std::vector<HookWithId<bool(Entity*, Entity*)>> pre_collision2;
-};
-
 // Creates an instance of this entity
 using EntityCreate = Entity* (*)();
 using EntityDestroy = void (*)(Entity*);
@@ -153,6 +134,8 @@ EntityDB* get_type(uint32_t id);
 
 ENT_TYPE to_id(std::string_view id);
 
+ENT_TYPE to_id(HashedEntityTypeName name);
+
 class Vector
 {
   public:
@@ -470,4 +453,27 @@ std::tuple<float, float> get_velocity(uint32_t uid);
 
 AABB get_hitbox(uint32_t uid, bool use_render_pos);
 
+// Properties of many entities in one array per property, entry i of every array belongs to uids[i]
+// Entities that don't exist get the same zeros as get_position, get_velocity and get_hitbox return for them
+struct EntityProperties
+{
+    std::vector<uint32_t> uids;
+    std::vector<ENT_TYPE> types;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<uint8_t> layers;
+    std::vector<float> velocity_x;
+    std::vector<float> velocity_y;
+    std::vector<AABB> hitboxes;
+
+    void clear();
+    void push_back(uint32_t uid, Entity* ent, bool use_render_pos);
+};
+
+// Fills out with the properties of every uid, reusing the memory of out
+void get_entity_properties(std::span<const uint32_t> uids, bool use_render_pos, EntityProperties& out);
+
+// Hooks the vtable of the entity if its type has hooks from set_pre_statemachine_for_type or set_post_statemachine_for_type
+void apply_entity_type_hooks(Entity* entity);
+
 struct EntityFactory* entity_factory();
@@ -0,0 +1,26 @@
+#include "entity_hooks_registry.hpp"
+
+EntityHooksInfo* EntityHooksRegistry::find(void* entity)
+{
+    auto it = m_Hooks.find(entity);
+    return it != m_Hooks.end() ? &it->second : nullptr;
+}
+std::pair<EntityHooksInfo&, bool> EntityHooksRegistry::get_or_add(void* entity)
+{
+    auto [it, inserted] = m_Hooks.try_emplace(entity, EntityHooksInfo{entity});
+    return {it->second, inserted};
+}
+void EntityHooksRegistry::on_dtor(void* entity)
+{
+    auto it = m_Hooks.find(entity);
+    if (it != m_Hooks.end())
+    {
+        // Callbacks may hook other entities, which can rehash the map, so only the reference is kept
+        EntityHooksInfo& hook_info = it->second;
+        for (auto& cb : hook_info.on_dtor)
+        {
+            cb.fun(static_cast<Entity*>(entity));
+        }
+        m_Hooks.erase(entity);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Entity;
+class Movable;
+class Container;
+
+template <class FunT>
+struct HookWithId
+{
+    std::uint32_t id;
+    std::function<FunT> fun;
+};
+struct EntityHooksInfo
+{
+    void* entity;
+    std::uint32_t cbcount;
+    std::vector<HookWithId<void(Entity*)>> on_dtor;
+    std::vector<HookWithId<void(Entity*)>> on_destroy;
+    std::vector<HookWithId<void(Entity*, Entity*)>> on_kill;
+    std::vector<HookWithId<bool(Entity*)>> on_player_instagib;
+    std::vector<HookWithId<bool(Entity*, Entity*, int8_t, float, float, uint16_t, uint8_t)>> on_damage;
+    std::vector<HookWithId<bool(Movable*)>> pre_statemachine;
+    std::vector<HookWithId<void(Movable*)>> post_statemachine;
+    std::vector<HookWithId<void(Container*, Movable*)>> on_open;
+    std::vector<HookWithId<bool(Entity*, Entity*)>> pre_collision1;
+    std::vector<HookWithId<bool(Entity*, Entity*)>> pre_collision2;
+};
+
+// Hooks of every hooked entity, keyed by the entity
+// References stay valid while other entities are hooked or unhooked, only on_dtor of the entity itself drops them
+// Kept apart from entity.cpp so it can be used without the game, e.g. by the entity_hooks_bench
+class EntityHooksRegistry
+{
+  public:
+    EntityHooksInfo* find(void* entity);
+    // The bool is true if the entity had no hooks yet, the caller then has to make sure on_dtor gets called for it
+    std::pair<EntityHooksInfo&, bool> get_or_add(void* entity);
+    // Runs the on_dtor callbacks of the entity and drops its hooks
+    void on_dtor(void* entity);
+
+    std::size_t size() const
+    {
+        return m_Hooks.size();
+    }
+
+  private:
+    std::unordered_map<void*, EntityHooksInfo> m_Hooks;
+};
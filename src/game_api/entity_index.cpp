@@ -0,0 +1,252 @@
+#include "entity_index.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <optional>
+
+#include <Windows.h>
+#include <detours.h>
+
+#include "entity.hpp"
+#include "layer.hpp"
+#include "logger.h"
+#include "search.hpp"
+#include "state.hpp"
+
+void EntitySpatialGrid::build(Layer* layer)
+{
+    cell_offsets.assign(static_cast<size_t>(width * height) + 1, 0);
+    entries.clear();
+    oversized.clear();
+    entities.assign(layer->all_entities.begin(), layer->all_entities.end());
+    marks.assign((entities.size() + 63) / 64, 0);
+    scratch.clear();
+    scratch.reserve(layer->all_entities.size);
+
+    // First pass computes the cells of every entity and counts the entries per cell
+    for (uint32_t order = 0; order < layer->all_entities.size; order++)
+    {
+        Entity* entity = layer->all_entities.ent_list[order];
+        const auto [x, y] = entity->position();
+        const float left = x - entity->hitboxx + entity->offsetx;
+        const float right = x + entity->hitboxx + entity->offsetx;
+        const float bottom = y - entity->hitboxy + entity->offsety;
+        const float top = y + entity->hitboxy + entity->offsety;
+
+        const Bounds bounds{
+            std::min(cell_of(left, width), cell_of(x, width)),
+            std::max(cell_before(right, width), cell_of(x, width)),
+            std::min(cell_of(bottom, height), cell_of(y, height)),
+            std::max(cell_before(top, height), cell_of(y, height)),
+        };
+        if ((bounds.last_x - bounds.first_x + 1) * (bounds.last_y - bounds.first_y + 1) > max_cells_per_entity)
+        {
+            oversized.push_back(order);
+            continue;
+        }
+
+        scratch.push_back({order, bounds});
+        for (int32_t cy = bounds.first_y; cy <= bounds.last_y; cy++)
+        {
+            for (int32_t cx = bounds.first_x; cx <= bounds.last_x; cx++)
+            {
+                cell_offsets[static_cast<size_t>(cy * width + cx) + 1]++;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < cell_offsets.size(); i++)
+    {
+        cell_offsets[i] += cell_offsets[i - 1];
+    }
+
+    // Second pass fills the cells, cell_offsets[cell] is used as the insertion point and restored afterwards
+    entries.resize(cell_offsets.back());
+    for (const auto& [order, bounds] : scratch)
+    {
+        for (int32_t cy = bounds.first_y; cy <= bounds.last_y; cy++)
+        {
+            for (int32_t cx = bounds.first_x; cx <= bounds.last_x; cx++)
+            {
+                entries[cell_offsets[static_cast<size_t>(cy * width + cx)]++] = order;
+            }
+        }
+    }
+    for (size_t i = cell_offsets.size() - 1; i > 0; i--)
+    {
+        cell_offsets[i] = cell_offsets[i - 1];
+    }
+    cell_offsets[0] = 0;
+}
+
+void EntityTypeBuckets::build(Layer* layer)
+{
+    type_offsets.clear();
+    type_search_flags.clear();
+    types.clear();
+
+    // Counting sort by type, the uids array of the layer is parallel to the entity list
+    Entities& all_entities = layer->all_entities;
+    for (Entity* entity : all_entities)
+    {
+        const ENT_TYPE type = entity->type->id;
+        if (type + 2 > type_offsets.size())
+        {
+            type_offsets.resize(type + 2, 0);
+            type_search_flags.resize(type + 1, 0);
+        }
+        if (type_offsets[type + 1]++ == 0)
+        {
+            types.push_back(type);
+            type_search_flags[type] = entity->type->search_flags;
+        }
+    }
+    std::sort(types.begin(), types.end());
+
+    for (size_t i = 1; i < type_offsets.size(); i++)
+    {
+        type_offsets[i] += type_offsets[i - 1];
+    }
+
+    uids.resize(all_entities.size);
+    entities.resize(all_entities.size);
+    orders.resize(all_entities.size);
+    for (uint32_t i = 0; i < all_entities.size; i++)
+    {
+        Entity* entity = all_entities.ent_list[i];
+        const uint32_t slot = type_offsets[entity->type->id]++;
+        uids[slot] = all_entities.uids[i];
+        entities[slot] = entity;
+        orders[slot] = i;
+    }
+    for (size_t i = type_offsets.size() - 1; i > 0; i--)
+    {
+        type_offsets[i] = type_offsets[i - 1];
+    }
+    if (!type_offsets.empty())
+    {
+        type_offsets[0] = 0;
+    }
+}
+
+struct EntityIndexKey
+{
+    uint32_t frame;
+    uint64_t generation;
+    Layer* layer;
+    Entity** ent_list;
+    uint32_t size;
+
+    bool operator==(const EntityIndexKey&) const = default;
+};
+
+template <class IndexT>
+struct LazyEntityIndex
+{
+    IndexT index;
+    std::optional<EntityIndexKey> built_for;
+    std::optional<EntityIndexKey> queried_for;
+
+    const IndexT* get(const EntityIndexKey& key, Layer* layer)
+    {
+        if (built_for != key)
+        {
+            if (queried_for != key)
+            {
+                queried_for = key;
+                return nullptr;
+            }
+            index.build(layer);
+            built_for = key;
+        }
+        return &index;
+    }
+};
+
+struct LayerEntityIndex
+{
+    LazyEntityIndex<EntitySpatialGrid> grid;
+    LazyEntityIndex<EntityTypeBuckets> type_buckets;
+};
+
+// Bumped on the level generation thread as well, through spawns and the layer hooks below
+std::atomic<uint64_t> g_entity_index_generation{0};
+std::array<LayerEntityIndex, 2> g_entity_indices;
+
+std::optional<EntityIndexKey> make_entity_index_key(Layer* layer)
+{
+    auto& state = State::get();
+    if (state.layer(layer->is_back_layer ? 1 : 0) != layer)
+    {
+        return std::nullopt;
+    }
+    return EntityIndexKey{
+        state.get_frame_count(),
+        g_entity_index_generation.load(std::memory_order_relaxed),
+        layer,
+        layer->all_entities.ent_list,
+        layer->all_entities.size,
+    };
+}
+
+const EntitySpatialGrid* get_entity_spatial_grid(Layer* layer)
+{
+    if (auto key = make_entity_index_key(layer))
+    {
+        return g_entity_indices[layer->is_back_layer ? 1 : 0].grid.get(key.value(), layer);
+    }
+    return nullptr;
+}
+
+const EntityTypeBuckets* get_entity_type_buckets(Layer* layer)
+{
+    if (auto key = make_entity_index_key(layer))
+    {
+        return g_entity_indices[layer->is_back_layer ? 1 : 0].type_buckets.get(key.value(), layer);
+    }
+    return nullptr;
+}
+
+void invalidate_entity_index()
+{
+    g_entity_index_generation.fetch_add(1, std::memory_order_relaxed);
+}
+uint64_t get_entity_index_generation()
+{
+    return g_entity_index_generation.load(std::memory_order_relaxed);
+}
+
+// Every entity the game puts into or takes out of Layer::all_entities goes through one of these, whether it is spawned,
+// destroyed or moved to the other layer
+using LayerEntityFun = void(Layer*, Entity*);
+LayerEntityFun* g_add_to_layer_trampoline{nullptr};
+LayerEntityFun* g_remove_from_layer_trampoline{nullptr};
+void add_to_layer(Layer* layer, Entity* entity)
+{
+    g_add_to_layer_trampoline(layer, entity);
+    invalidate_entity_index();
+}
+void remove_from_layer(Layer* layer, Entity* entity)
+{
+    g_remove_from_layer_trampoline(layer, entity);
+    invalidate_entity_index();
+}
+
+void init_entity_index_hooks()
+{
+    DetourTransactionBegin();
+    DetourUpdateThread(GetCurrentThread());
+
+    g_add_to_layer_trampoline = (LayerEntityFun*)get_address("add_to_layer");
+    g_remove_from_layer_trampoline = (LayerEntityFun*)get_address("remove_from_layer");
+
+    DetourAttach((void**)&g_add_to_layer_trampoline, (LayerEntityFun*)add_to_layer);
+    DetourAttach((void**)&g_remove_from_layer_trampoline, (LayerEntityFun*)remove_from_layer);
+
+    const LONG error = DetourTransactionCommit();
+    if (error != NO_ERROR)
+    {
+        DEBUG("Failed hooking add_to_layer/remove_from_layer: {}\n", error);
+    }
+}
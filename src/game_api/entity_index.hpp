@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "aliases.hpp"
+
+class Entity;
+struct Layer;
+
+// Uniform grid over one layer with one cell per tile of Layer::grid_entities, cell (x, y) covers [x - 0.5, x + 0.5)
+// Every entity is put in all cells touched by its hitbox and its position, positions outside of the level are clamped
+// to the border cells, so queries outside of the level still find them
+// Cells hold indices into Layer::all_entities, a query marks the indices it touches in a bitset and then walks the
+// bitset, so results come out in list order and an entity in several cells is only reported once, without sorting
+class EntitySpatialGrid
+{
+  public:
+    static constexpr int32_t width = 0x56;
+    static constexpr int32_t height = 0x7e;
+
+    void build(Layer* layer);
+
+    // Calls fun(Entity*) once for every entity whose hitbox or position may lie in [left, right] x [bottom, top], in the
+    // order of Layer::all_entities so results don't depend on whether a query used the grid or a linear scan
+    // Callers still have to do the exact test, positions are only as recent as the last build
+    template <class FunT>
+    void for_each_candidate(float left, float bottom, float right, float top, FunT&& fun) const
+    {
+        with_marks([&](std::vector<uint64_t>& marks)
+                   {
+                       size_t first_word = marks.size();
+                       size_t last_word = 0;
+                       auto mark = [&](uint32_t order)
+                       {
+                           const size_t word = order / 64;
+                           marks[word] |= 1ull << (order % 64);
+                           first_word = std::min(first_word, word);
+                           last_word = std::max(last_word, word);
+                       };
+
+                       for (uint32_t order : oversized)
+                       {
+                           mark(order);
+                       }
+                       const int32_t first_x = cell_of(left, width);
+                       const int32_t last_x = cell_of(right, width);
+                       const int32_t first_y = cell_of(bottom, height);
+                       const int32_t last_y = cell_of(top, height);
+                       for (int32_t y = first_y; y <= last_y; y++)
+                       {
+                           for (int32_t x = first_x; x <= last_x; x++)
+                           {
+                               const uint32_t cell = static_cast<uint32_t>(y * width + x);
+                               for (uint32_t i = cell_offsets[cell]; i < cell_offsets[cell + 1]; i++)
+                               {
+                                   mark(entries[i]);
+                               }
+                           }
+                       }
+
+                       for (size_t word = first_word; word <= last_word && word < marks.size(); word++)
+                       {
+                           for (uint64_t bits = marks[word]; bits != 0; bits &= bits - 1)
+                           {
+                               fun(entities[word * 64 + std::countr_zero(bits)]);
+                           }
+                       }
+                   });
+    }
+
+    // Calls fun(Entity*) once for every entity around (x, y), going outwards one ring of cells at a time, oversized
+    // entities come first
+    // After every ring, done(distance) decides whether to stop, distance is a lower bound of the distance from (x, y) to
+    // the positions of all entities that were not visited yet, as of the last build
+    template <class FunT, class DoneT>
+    void for_each_nearby(float x, float y, FunT&& fun, DoneT&& done) const
+    {
+        with_marks([&](std::vector<uint64_t>& marks)
+                   {
+                       auto visit = [&](uint32_t order)
+                       {
+                           uint64_t& word = marks[order / 64];
+                           const uint64_t bit = 1ull << (order % 64);
+                           if ((word & bit) == 0)
+                           {
+                               word |= bit;
+                               fun(entities[order]);
+                           }
+                       };
+
+                       for (uint32_t order : oversized)
+                       {
+                           visit(order);
+                       }
+                       // Positions outside of the grid are clamped to the border cells on both sides, so the bound
+                       // still holds for queries outside of the level
+                       const int32_t center_x = cell_of(x, width);
+                       const int32_t center_y = cell_of(y, height);
+                       const int32_t last_ring = std::max({center_x, width - 1 - center_x, center_y, height - 1 - center_y});
+                       for (int32_t ring = 0; ring <= last_ring; ring++)
+                       {
+                           for (int32_t cy = std::max(center_y - ring, 0); cy <= std::min(center_y + ring, height - 1); cy++)
+                           {
+                               // Rows in the middle of the ring only have their first and last cell in it
+                               const bool full_row = cy == center_y - ring || cy == center_y + ring;
+                               const int32_t step = full_row ? 1 : 2 * ring;
+                               for (int32_t cx = center_x - ring; cx <= center_x + ring; cx += step)
+                               {
+                                   if (cx < 0 || cx >= width)
+                                   {
+                                       continue;
+                                   }
+                                   const uint32_t cell = static_cast<uint32_t>(cy * width + cx);
+                                   for (uint32_t i = cell_offsets[cell]; i < cell_offsets[cell + 1]; i++)
+                                   {
+                                       visit(entries[i]);
+                                   }
+                               }
+                           }
+                           // Every position in a cell of a later ring is at least this far away
+                           if (done(static_cast<float>(ring)))
+                           {
+                               return;
+                           }
+                       }
+                   });
+    }
+
+  private:
+    struct Bounds
+    {
+        int32_t first_x;
+        int32_t last_x;
+        int32_t first_y;
+        int32_t last_y;
+    };
+
+    // Entities covering more cells than this are not put in the grid but checked by every query
+    static constexpr int32_t max_cells_per_entity = 16;
+
+    // Cell containing pos
+    static int32_t cell_of(float pos, int32_t size)
+    {
+        return clamp_cell(std::floor(pos + 0.5f), size);
+    }
+    // Last cell that starts before pos, the right and top edges of hitboxes are exclusive
+    static int32_t cell_before(float pos, int32_t size)
+    {
+        return clamp_cell(std::ceil(pos + 0.5f) - 1.0f, size);
+    }
+    static int32_t clamp_cell(float cell, int32_t size)
+    {
+        if (!(cell >= 0.0f)) // also catches NaN
+        {
+            return 0;
+        }
+        return cell < static_cast<float>(size - 1) ? static_cast<int32_t>(cell) : size - 1;
+    }
+
+    // Calls fun with a cleared bitset of one bit per entity, the bitset of the grid is reused and cleared again
+    // afterwards, a query made from inside the callback of another query gets a bitset of its own
+    template <class FunT>
+    void with_marks(FunT&& fun) const
+    {
+        if (in_query)
+        {
+            std::vector<uint64_t> nested_marks(marks.size(), 0);
+            fun(nested_marks);
+            return;
+        }
+        struct ClearMarks
+        {
+            const EntitySpatialGrid& grid;
+            ~ClearMarks()
+            {
+                std::fill(grid.marks.begin(), grid.marks.end(), 0);
+                grid.in_query = false;
+            }
+        };
+        in_query = true;
+        ClearMarks clear_marks{*this};
+        fun(marks);
+    }
+
+    std::vector<uint32_t> cell_offsets;
+    // Indices into entities, every cell is in list order
+    std::vector<uint32_t> entries;
+    std::vector<uint32_t> oversized;
+    // Layer::all_entities as of the last build
+    std::vector<Entity*> entities;
+    std::vector<std::pair<uint32_t, Bounds>> scratch;
+    mutable std::vector<uint64_t> marks;
+    mutable bool in_query{false};
+};
+
+// All entities of one layer grouped by their type, every type also remembers its search_flags so mask queries can
+// skip whole types instead of single entities
+class EntityTypeBuckets
+{
+  public:
+    void build(Layer* layer);
+
+    std::span<const uint32_t> uids_of(ENT_TYPE type) const
+    {
+        if (type + 1 >= type_offsets.size())
+        {
+            return {};
+        }
+        return {uids.data() + type_offsets[type], uids.data() + type_offsets[type + 1]};
+    }
+    std::span<Entity* const> entities_of(ENT_TYPE type) const
+    {
+        if (type + 1 >= type_offsets.size())
+        {
+            return {};
+        }
+        return {entities.data() + type_offsets[type], entities.data() + type_offsets[type + 1]};
+    }
+    // Index in Layer::all_entities of every entity in entities_of, ascending within a type
+    std::span<const uint32_t> orders_of(ENT_TYPE type) const
+    {
+        if (type + 1 >= type_offsets.size())
+        {
+            return {};
+        }
+        return {orders.data() + type_offsets[type], orders.data() + type_offsets[type + 1]};
+    }
+    uint32_t search_flags_of(ENT_TYPE type) const
+    {
+        return type < type_search_flags.size() ? type_search_flags[type] : 0;
+    }
+    // Types that have at least one entity in the layer, in ascending order
+    std::span<const ENT_TYPE> present_types() const
+    {
+        return types;
+    }
+
+  private:
+    std::vector<uint32_t> type_offsets;
+    std::vector<uint32_t> type_search_flags;
+    std::vector<ENT_TYPE> types;
+    std::vector<uint32_t> uids;
+    std::vector<Entity*> entities;
+    std::vector<uint32_t> orders;
+};
+
+// Returns the spatial grid of the layer if it is worth using for the current frame, building it if needed
+// Returns nullptr for the first query after the layer changed, since a single query is cheaper done linearly than
+// building the grid for it, callers then scan Layer::all_entities themselves and the second query builds the grid
+// Also returns nullptr for layers that are not part of the main-thread state, e.g. during level generation on a loading
+// thread
+const EntitySpatialGrid* get_entity_spatial_grid(Layer* layer);
+
+// Same as get_entity_spatial_grid but for the type buckets of the layer
+const EntityTypeBuckets* get_entity_type_buckets(Layer* layer);
+
+// Forces the next query to rebuild the index, called whenever entities are spawned, removed, teleported or moved by a script
+// and by the hooks of init_entity_index_hooks whenever the game adds entities to a layer or removes them from one
+void invalidate_entity_index();
+// Changes with every call to invalidate_entity_index, lets other caches share the invalidation
+uint64_t get_entity_index_generation();
+// Hooks the game's add_to_layer and remove_from_layer, so checking whether an index is still valid doesn't need to look at
+// the entity list
+void init_entity_index_hooks();
+
+// Entities may move a bit after the index was built in the same frame, queries are grown by this many tiles
+inline constexpr float g_entity_index_slack = 1.0f;
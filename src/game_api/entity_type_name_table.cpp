@@ -0,0 +1,59 @@
+#include "entity_type_name_table.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+EntityTypeNameTable::EntityTypeNameTable(const EntityMap& map)
+{
+    const size_t num_names = map.size();
+    num_buckets = std::max<size_t>(num_names / 4, 1);
+    const size_t num_slots = std::bit_ceil(num_names + num_names / 2 + 1);
+    slot_mask = num_slots - 1;
+    bucket_seeds.assign(num_buckets, 0);
+    slots.assign(num_slots, {});
+
+    std::vector<std::vector<std::pair<uint64_t, const EntityMap::value_type*>>> buckets(num_buckets);
+    for (const auto& entry : map)
+    {
+        const uint64_t hash = hash_entity_type_name(entry.first);
+        buckets[hash % num_buckets].push_back({hash, &entry});
+    }
+
+    // Big buckets are placed first while there are many free slots
+    std::vector<size_t> order(num_buckets);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+              { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<size_t> bucket_slots;
+    for (size_t bucket : order)
+    {
+        if (buckets[bucket].empty())
+            break;
+        for (uint32_t seed = 1;; seed++)
+        {
+            if (seed == 1u << 20)
+            {
+                // Never happens with the names of the game, to_id just uses the map if it does
+                slots.clear();
+                return;
+            }
+            bucket_slots.clear();
+            for (auto& [hash, entry] : buckets[bucket])
+            {
+                const size_t slot = slot_of(hash, seed);
+                if (!slots[slot].first.empty() || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end())
+                    break;
+                bucket_slots.push_back(slot);
+            }
+            if (bucket_slots.size() == buckets[bucket].size())
+            {
+                bucket_seeds[bucket] = seed;
+                for (size_t i = 0; i < bucket_slots.size(); i++)
+                    slots[bucket_slots[i]] = {buckets[bucket][i].second->first, buckets[bucket][i].second->second};
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "aliases.hpp"
+
+// Name to id map of the entity factory
+using EntityMap = std::unordered_map<std::string, uint16_t>;
+
+// FNV-1a of an ENT_TYPE name, the same hash is used by the name table behind to_id
+constexpr uint64_t hash_entity_type_name(std::string_view name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+struct HashedEntityTypeName
+{
+    std::string_view name;
+    uint64_t hash;
+};
+// Hashes the name at compile time, so to_id("ENT_TYPE_ITEM_COFFIN"_ent_type) only costs a table lookup
+// Code that runs often still keeps the id in a function-local static, so the lookup is only done on the first call
+consteval HashedEntityTypeName operator""_ent_type(const char* name, size_t size)
+{
+    return HashedEntityTypeName{std::string_view{name, size}, hash_entity_type_name(std::string_view{name, size})};
+}
+
+// Perfect hash over the names in the entity map built with hash and displace: names are split into small buckets by
+// their hash and every bucket gets a seed that moves all of its names to free slots, a lookup is then two array reads
+// and one string compare
+// The table keeps views of the names in the map, so the map has to outlive it
+class EntityTypeNameTable
+{
+  public:
+    explicit EntityTypeNameTable(const EntityMap& map);
+
+    std::optional<ENT_TYPE> find(std::string_view name, uint64_t hash) const
+    {
+        if (slots.empty())
+            return std::nullopt;
+        const auto& [slot_name, id] = slots[slot_of(hash, bucket_seeds[hash % num_buckets])];
+        if (slot_name != name)
+            return std::nullopt;
+        return id;
+    }
+    std::optional<ENT_TYPE> find(HashedEntityTypeName name) const
+    {
+        return find(name.name, name.hash);
+    }
+
+  private:
+    size_t slot_of(uint64_t hash, uint32_t seed) const
+    {
+        // splitmix64 finalizer, spreads the names of one bucket over the whole table
+        uint64_t mixed = hash ^ (seed * 0x9e3779b97f4a7c15ull);
+        mixed = (mixed ^ (mixed >> 30)) * 0xbf58476d1ce4e5b9ull;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<size_t>(mixed ^ (mixed >> 31)) & slot_mask;
+    }
+
+    size_t num_buckets;
+    size_t slot_mask;
+    std::vector<uint32_t> bucket_seeds;
+    std::vector<std::pair<std::string_view, ENT_TYPE>> slots;
+};
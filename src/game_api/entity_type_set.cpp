@@ -0,0 +1,51 @@
+#include "entity_type_set.hpp"
+
+#include <algorithm>
+
+EntityTypeSet::EntityTypeSet(ENT_TYPE entity_type)
+{
+    add(entity_type);
+}
+
+EntityTypeSet::EntityTypeSet(const std::vector<ENT_TYPE>& entity_types)
+{
+    if (entity_types.empty() || entity_types[0] == 0)
+    {
+        return;
+    }
+    for (ENT_TYPE entity_type : entity_types)
+    {
+        add(entity_type);
+    }
+}
+
+void EntityTypeSet::add(ENT_TYPE entity_type)
+{
+    if (entity_type == 0)
+    {
+        return;
+    }
+
+    auto add_one = [this](ENT_TYPE type)
+    {
+        if (type < max_types && !bits[type])
+        {
+            bits[type] = true;
+            sorted_types.insert(std::upper_bound(sorted_types.begin(), sorted_types.end(), type), type);
+        }
+    };
+
+    // Once anything was added the set only matches what is in it, even unknown types that are never matched
+    any_type = false;
+    if (entity_type >= max_types)
+    {
+        for (ENT_TYPE type : get_custom_entity_types(static_cast<CUSTOM_TYPE>(entity_type)))
+        {
+            add_one(type);
+        }
+    }
+    else
+    {
+        add_one(entity_type);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "aliases.hpp"
+#include "custom_types.hpp"
+
+// Filter over entity types that is built once and then checked with a single bit test per entity
+// Follows the rules of the type lists taken by get_entities_by, i.e. an empty list or a list starting with 0 matches
+// every type and CUSTOM_TYPEs are expanded to the types they stand for
+class EntityTypeSet
+{
+  public:
+    // All ENT_TYPEs are below the first CUSTOM_TYPE
+    static constexpr size_t max_types = static_cast<size_t>(CUSTOM_TYPE::ACIDBUBBLE);
+
+    EntityTypeSet() = default;
+    explicit EntityTypeSet(ENT_TYPE entity_type);
+    explicit EntityTypeSet(const std::vector<ENT_TYPE>& entity_types);
+
+    bool contains(ENT_TYPE entity_type) const
+    {
+        return any_type || (entity_type < max_types && bits[entity_type]);
+    }
+    bool matches_all() const
+    {
+        return any_type;
+    }
+    // The types in the set in ascending order, empty if the set matches all types
+    std::span<const ENT_TYPE> types() const
+    {
+        return sorted_types;
+    }
+
+    // Adds a type or the types of a CUSTOM_TYPE, adding 0 is ignored
+    void add(ENT_TYPE entity_type);
+
+  private:
+    std::bitset<max_types> bits;
+    std::vector<ENT_TYPE> sorted_types;
+    bool any_type{true};
+};
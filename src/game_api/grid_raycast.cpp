@@ -0,0 +1,107 @@
+#include "grid_raycast.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "entity.hpp"
+#include "layer.hpp"
+#include "rpc.hpp"
+#include "state.hpp"
+
+// Same dimensions as Layer::grid_entities, tile (x, y) covers [x - 0.5, x + 0.5)
+constexpr int32_t g_grid_width = 0x56;
+constexpr int32_t g_grid_height = 0x7e;
+
+// Clips the parameter range [t0, t1] of pos + t * dir to [min, max], returns false if nothing is left
+bool clip_ray(float pos, float dir, float min, float max, float& t0, float& t1)
+{
+    if (dir == 0.0f)
+    {
+        return pos >= min && pos < max;
+    }
+    float enter = (min - pos) / dir;
+    float exit = (max - pos) / dir;
+    if (enter > exit)
+    {
+        std::swap(enter, exit);
+    }
+    t0 = std::max(t0, enter);
+    t1 = std::min(t1, exit);
+    return t0 <= t1;
+}
+
+RaycastHit raycast_grid(Layer* layer, float x1, float y1, float x2, float y2, uint32_t mask)
+{
+    const float dx = x2 - x1;
+    const float dy = y2 - y1;
+    const float length = std::sqrt(dx * dx + dy * dy);
+    RaycastHit result{-1, x2, y2, length};
+
+    // Only the part of the ray inside of the grid is walked, so far away or huge rays cost no more than a level crossing
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    if (!clip_ray(x1, dx, -0.5f, g_grid_width - 0.5f, t0, t1) || !clip_ray(y1, dy, -0.5f, g_grid_height - 0.5f, t0, t1))
+    {
+        return result;
+    }
+
+    auto tile_of = [](float pos, int32_t size)
+    { return std::clamp(static_cast<int32_t>(std::floor(pos + 0.5f)), 0, size - 1); };
+    int32_t tx = tile_of(x1 + dx * t0, g_grid_width);
+    int32_t ty = tile_of(y1 + dy * t0, g_grid_height);
+
+    // Parameter t at which the ray crosses the next tile border on each axis and how much t grows per tile
+    constexpr float never = std::numeric_limits<float>::infinity();
+    const int32_t step_x = dx > 0.0f ? 1 : -1;
+    const int32_t step_y = dy > 0.0f ? 1 : -1;
+    const float delta_x = dx != 0.0f ? 1.0f / std::abs(dx) : never;
+    const float delta_y = dy != 0.0f ? 1.0f / std::abs(dy) : never;
+    float next_x = dx != 0.0f ? (tx + 0.5f * step_x - x1) / dx : never;
+    float next_y = dy != 0.0f ? (ty + 0.5f * step_y - y1) / dy : never;
+
+    float t = t0;
+    while (tx >= 0 && tx < g_grid_width && ty >= 0 && ty < g_grid_height)
+    {
+        Entity* ent = layer->grid_entities[ty][tx];
+        if (ent != nullptr && (mask == 0 || (ent->type->search_flags & mask)))
+        {
+            return RaycastHit{static_cast<int32_t>(ent->uid), x1 + dx * t, y1 + dy * t, length * t};
+        }
+
+        if (next_x < next_y)
+        {
+            t = next_x;
+            next_x += delta_x;
+            tx += step_x;
+        }
+        else
+        {
+            t = next_y;
+            next_y += delta_y;
+            ty += step_y;
+        }
+        if (t > t1)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+RaycastHit raycast_grid(float x1, float y1, float x2, float y2, LAYER layer, uint32_t mask)
+{
+    return raycast_grid(State::get().layer(enum_to_layer(layer)), x1, y1, x2, y2, mask);
+}
+
+std::vector<RaycastHit> raycast_grid_many(std::span<const float> rays, LAYER layer, uint32_t mask)
+{
+    Layer* actual_layer = State::get().layer(enum_to_layer(layer));
+    std::vector<RaycastHit> hits;
+    hits.reserve(rays.size() / 4);
+    for (size_t i = 0; i + 3 < rays.size(); i += 4)
+    {
+        hits.push_back(raycast_grid(actual_layer, rays[i], rays[i + 1], rays[i + 2], rays[i + 3], mask));
+    }
+    return hits;
+}
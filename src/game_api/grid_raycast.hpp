@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "aliases.hpp"
+
+struct Layer;
+
+struct RaycastHit
+{
+    /// uid of the grid entity that was hit, -1 if the ray reached its end without hitting anything
+    int32_t uid{-1};
+    /// Point where the ray entered the tile of the hit entity, or the end of the ray
+    float x{0.0f};
+    float y{0.0f};
+    /// Distance from the start of the ray to `x`, `y`
+    float distance{0.0f};
+};
+
+// Steps through Layer::grid_entities from (x1, y1) to (x2, y2) and returns the first grid entity with any of the
+// search_flags in mask, or any grid entity if mask is 0
+RaycastHit raycast_grid(Layer* layer, float x1, float y1, float x2, float y2, uint32_t mask);
+RaycastHit raycast_grid(float x1, float y1, float x2, float y2, LAYER layer, uint32_t mask);
+
+// Same as raycast_grid for every ray in rays, which holds x1, y1, x2, y2 of one ray after the other
+std::vector<RaycastHit> raycast_grid_many(std::span<const float> rays, LAYER layer, uint32_t mask);
@@ -104,6 +104,9 @@ Entity* Layer::get_grid_entity_at(float x, float y)
 
 Entity* Layer::spawn_door(float x, float y, uint8_t w, uint8_t l, uint8_t t)
 {
+    static const ENT_TYPE starting_exit = to_id("ENT_TYPE_FLOOR_DOOR_STARTING_EXIT"_ent_type);
+    static const ENT_TYPE door_exit = to_id("ENT_TYPE_FLOOR_DOOR_EXIT"_ent_type);
+    static const ENT_TYPE platform_spawner = to_id("ENT_TYPE_LOGICAL_PLATFORM_SPAWNER"_ent_type);
     auto screen = State::get().ptr()->screen_next;
     Entity* door;
     switch (screen)
@@ -111,13 +114,13 @@ Entity* Layer::spawn_door(float x, float y, uint8_t w, uint8_t l, uint8_t t)
     case 11:
     {
         DEBUG("In camp, spawning starting exit");
-        door = spawn_entity(to_id("ENT_TYPE_FLOOR_DOOR_STARTING_EXIT"), round(x), round(y), false, 0.0, 0.0, true);
+        door = spawn_entity(starting_exit, round(x), round(y), false, 0.0, 0.0, true);
         break;
     }
     case 12:
     {
         DEBUG("In game, spawning regular exit");
-        door = spawn_entity(to_id("ENT_TYPE_FLOOR_DOOR_EXIT"), round(x), round(y), false, 0.0, 0.0, true);
+        door = spawn_entity(door_exit, round(x), round(y), false, 0.0, 0.0, true);
         break;
     }
     default:
@@ -127,7 +130,7 @@ Entity* Layer::spawn_door(float x, float y, uint8_t w, uint8_t l, uint8_t t)
     door->as<ExitDoor>()->level = l;
     door->as<ExitDoor>()->theme = t;
     door->as<ExitDoor>()->special_door = true;
-    spawn_entity(to_id("ENT_TYPE_LOGICAL_PLATFORM_SPAWNER"), round(x), round(y - 1.0f), false, 0.0, 0.0, true);
+    spawn_entity(platform_spawner, round(x), round(y - 1.0f), false, 0.0, 0.0, true);
     return door;
 }
 
@@ -150,20 +153,17 @@ Entity* Layer::spawn_apep(float x, float y, bool right)
         int current_uid = apep_head->uid;
         do
         {
-            auto body_parts = entity_get_items_by(current_uid, {}, 0);
             int temp = current_uid;
-            for (auto body_part_uid : body_parts)
-            {
-                Entity* body_part = get_entity_ptr(body_part_uid);
-                body_part->flags = right
-                                       ? body_part->flags & ~facing_left_flag
-                                       : body_part->flags | facing_left_flag;
-                body_part->x *= -1.0f;
-                if (body_part->type->id == body_id)
-                {
-                    current_uid = body_part_uid;
-                }
-            }
+            for_each_entity_item_by(temp, {}, 0, [&](Entity* body_part)
+                                    {
+                                        body_part->flags = right
+                                                               ? body_part->flags & ~facing_left_flag
+                                                               : body_part->flags | facing_left_flag;
+                                        body_part->x *= -1.0f;
+                                        if (body_part->type->id == body_id)
+                                        {
+                                            current_uid = body_part->uid;
+                                        } });
             if (temp == current_uid)
             {
                 break;
@@ -153,10 +153,12 @@ void g_spawn_punishball_attach(const CommunityTileCode& self, float x, float y,
     y += static_cast<float>(offset_y);
     auto do_spawn = [=]()
     {
-        std::vector<uint32_t> entities_neighbour = get_entities_overlapping_by_pointer({}, 0, x - 0.5f, y - 0.5f, x + 0.5f, y + 0.5f, layer);
-        if (!entities_neighbour.empty())
+        Entity* neighbour{nullptr};
+        for_each_entity_overlapping_by_pointer({}, 0, x - 0.5f, y - 0.5f, x + 0.5f, y + 0.5f, layer, [&neighbour](Entity* ent)
+                                               { neighbour = neighbour ? neighbour : ent; });
+        if (neighbour != nullptr)
         {
-            get_entity_ptr(attach_ball_and_chain(entities_neighbour.front(), -static_cast<float>(offset_x), -static_cast<float>(offset_y)));
+            attach_ball_and_chain(neighbour->uid, -static_cast<float>(offset_x), -static_cast<float>(offset_y));
             return;
         }
         layer->spawn_entity(self.entity_id, x, y, false, 0.0f, 0.0f, true);
@@ -380,8 +382,8 @@ std::array g_community_tile_codes{
         {
             Entity* slidingwall = layer->spawn_entity(self.entity_id, x, y, false, 0.0f, 0.0f, true);
             // hook the function that dereferences the top part of the trap (which is nullptr right now)
-            hook_vtable<void(Entity*, Entity*)>(
-                slidingwall, [](Entity*, Entity*, void (*)(Entity*, Entity*)) {}, 26);
+            hook_vtable<void(Entity*, Entity*), 26>(
+                slidingwall, [](Entity*, Entity*, void (*)(Entity*, Entity*)) {});
         },
     },
     CommunityTileCode{"spikeball_trap", "ENT_TYPE_FLOOR_SPIKEBALL_CEILING"},
@@ -422,22 +424,17 @@ std::array g_community_tile_codes{
 
             Entity* olmite = layer->spawn_entity_snap_to_floor(self.entity_id, x, y);
 
-            std::vector<uint32_t> entities_above = get_entities_overlapping_by_pointer({}, 0x4, x - 0.1f, y + 0.9f, x + 0.1f, y + 1.1f, layer);
-            for (uint32_t uid : entities_above)
-            {
-                if (Entity* ent = get_entity_ptr(uid))
-                {
-                    if (ent->type->id == helmet_id || ent->type->id == naked_id || ent->type->id == self.entity_id)
-                    {
-                        *(bool*)((size_t)ent + 0x151) = true;
-                        *(bool*)((size_t)olmite + 0x151) = true;
-                        *(uint32_t*)((size_t)olmite + 0x154) = ent->uid;
-
-                        static constexpr float offset[]{0.0f, 0.64f};
-                        stack_entities(olmite->uid, ent->uid, offset);
-                    }
-                }
-            }
+            for_each_entity_overlapping_by_pointer({}, 0x4, x - 0.1f, y + 0.9f, x + 0.1f, y + 1.1f, layer, [&](Entity* ent)
+                                                   {
+                                                       if (ent->type->id == helmet_id || ent->type->id == naked_id || ent->type->id == self.entity_id)
+                                                       {
+                                                           *(bool*)((size_t)ent + 0x151) = true;
+                                                           *(bool*)((size_t)olmite + 0x151) = true;
+                                                           *(uint32_t*)((size_t)olmite + 0x154) = ent->uid;
+
+                                                           static constexpr float offset[]{0.0f, 0.64f};
+                                                           stack_entities(olmite->uid, ent->uid, offset);
+                                                       } });
         },
     },
     // Wave 3
@@ -454,10 +451,12 @@ std::array g_community_tile_codes{
         {
             auto do_spawn = [=]()
             {
-                std::vector<uint32_t> entities_neighbour = get_entities_overlapping_by_pointer({}, 0, x - 0.5f, y - 1.5f, x + 0.5f, y - 0.5f, layer);
-                if (!entities_neighbour.empty())
+                Entity* neighbour{nullptr};
+                for_each_entity_overlapping_by_pointer({}, 0, x - 0.5f, y - 1.5f, x + 0.5f, y - 0.5f, layer, [&neighbour](Entity* ent)
+                                                       { neighbour = neighbour ? neighbour : ent; });
+                if (neighbour != nullptr)
                 {
-                    layer->spawn_entity_over(self.entity_id, get_entity_ptr(entities_neighbour.front()), 0.0f, 1.0f);
+                    layer->spawn_entity_over(self.entity_id, neighbour, 0.0f, 1.0f);
                 }
             };
             g_attachee_requiring_entities.push_back({{{x, y - 1}}, do_spawn});
@@ -1405,7 +1404,7 @@ void LevelGenSystem::init()
     for (ThemeInfo* theme : themes)
     {
         using PopulateLevelFun = void(ThemeInfo * self, uint64_t param_2, uint64_t param_3, uint64_t param_4);
-        hook_vtable<PopulateLevelFun>(
+        hook_vtable<PopulateLevelFun, 0xd>(
             theme, [](ThemeInfo* self, uint64_t param_2, uint64_t param_3, uint64_t param_4, PopulateLevelFun* original)
             {
                 post_room_generation();
@@ -1420,10 +1419,9 @@ void LevelGenSystem::init()
                 }
 
                 original(self, param_2, param_3, param_4);
-            },
-            0xd);
+            });
         using DoProceduralSpawnFun = void(ThemeInfo*, SpawnInfo*);
-        hook_vtable<DoProceduralSpawnFun>(
+        hook_vtable<DoProceduralSpawnFun, 0x33>(
             theme, [](ThemeInfo* self, SpawnInfo* spawn_info, DoProceduralSpawnFun* original)
             {
                 push_spawn_type_flags(SPAWN_TYPE_LEVEL_GEN_PROCEDURAL);
@@ -1435,8 +1433,7 @@ void LevelGenSystem::init()
                     return;
                 }
                 original(self, spawn_info);
-            },
-            0x33);
+            });
     }
 }
 
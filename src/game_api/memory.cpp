@@ -58,16 +58,6 @@ void write_mem(size_t addr, std::string payload)
     write_mem_prot(addr, payload, false);
 }
 
-size_t function_start(size_t off)
-{
-    off &= ~0xf;
-    while (read_u8(off - 1) != 0xcc)
-    {
-        off -= 0x10;
-    }
-    return off;
-}
-
 LPVOID alloc_mem_rel32(size_t addr, size_t size)
 {
     const size_t limit_addr = Memory::get().exe_ptr;
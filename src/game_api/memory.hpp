@@ -61,6 +61,7 @@ struct Memory
                 exe,
                 after_bundle,
             };
+            INIT = true;
         }
 
         return MEMORY;
@@ -93,7 +94,6 @@ LPVOID alloc_mem_rel32(size_t addr, size_t size);
 void write_mem_prot(size_t addr, std::string_view payload, bool prot);
 void write_mem_prot(size_t addr, std::string payload, bool prot);
 void write_mem(size_t addr, std::string payload);
-size_t function_start(size_t off);
 void write_mem_recoverable(std::string name, size_t addr, std::string_view payload, bool prot);
 void recover_mem(std::string name, size_t addr = NULL);
 
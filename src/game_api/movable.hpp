@@ -137,6 +137,12 @@ class Movable : public Entity
     void set_post_statemachine(std::uint32_t reserved_callback_id, std::function<void(Movable*)> post_state_machine);
 };
 
+// Statemachine hooks for every entity of a type, including the ones spawned later, return false if the type is invalid
+std::uint32_t reserve_entity_type_hook_id();
+bool set_pre_statemachine_for_type(ENT_TYPE entity_type, std::uint32_t reserved_callback_id, std::function<bool(Movable*)> pre_state_machine);
+bool set_post_statemachine_for_type(ENT_TYPE entity_type, std::uint32_t reserved_callback_id, std::function<void(Movable*)> post_state_machine);
+void clear_entity_type_hook(ENT_TYPE entity_type, std::uint32_t id);
+
 class PlayerTracker
 {
   public:
@@ -0,0 +1,398 @@
+#include "pathfinding.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+
+#include "entity.hpp"
+#include "entity_index.hpp"
+#include "layer.hpp"
+#include "rpc.hpp"
+#include "state.hpp"
+
+// Bits of Entity::flags, see ENT_FLAG
+constexpr uint32_t g_flag_solid = 1u << 2;
+constexpr uint32_t g_flag_platform = 1u << 7;
+constexpr uint32_t g_flag_climbable = 1u << 8;
+
+uint32_t LevelPathfinder::tile_of(float x, float y)
+{
+    const float tx = std::floor(x + 0.5f);
+    const float ty = std::floor(y + 0.5f);
+    if (!(tx >= 0.0f && tx < width && ty >= 0.0f && ty < height))
+    {
+        return width * height;
+    }
+    return static_cast<uint32_t>(ty) * width + static_cast<uint32_t>(tx);
+}
+
+size_t LevelPathfinder::update(Layer* layer)
+{
+    std::vector<uint32_t> opened;
+    size_t num_changed = 0;
+    bool any_closed = false;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            TileClass tile_class = TileClass::Open;
+            if (Entity* ent = layer->grid_entities[y][x])
+            {
+                if (ent->flags & g_flag_solid)
+                    tile_class = TileClass::Solid;
+                else if (ent->flags & g_flag_climbable)
+                    tile_class = TileClass::Climbable;
+                else if (ent->flags & g_flag_platform)
+                    tile_class = TileClass::Platform;
+            }
+
+            TileClass& old_class = tiles[y * width + x];
+            if (old_class != tile_class)
+            {
+                num_changed++;
+                if (old_class == TileClass::Solid)
+                    opened.push_back(y * width + x);
+                else if (tile_class == TileClass::Solid)
+                    any_closed = true;
+                old_class = tile_class;
+            }
+        }
+    }
+
+    if (num_changed == 0)
+    {
+        return 0;
+    }
+
+    cached_paths.clear();
+    for (FlowField& field : flow_fields)
+    {
+        // Opening tiles can only shorten paths when flying, when walking it may also take away the floor of the tile above
+        if (field.walking || any_closed || std::find(opened.begin(), opened.end(), field.target) != opened.end())
+            field.stale = true;
+        else if (!field.stale && !opened.empty())
+            repair_flow_field(field, opened);
+    }
+    return num_changed;
+}
+
+bool LevelPathfinder::is_open(int32_t x, int32_t y) const
+{
+    return x >= 0 && x < (int32_t)width && y >= 0 && y < (int32_t)height && tiles[y * width + x] != TileClass::Solid;
+}
+
+bool LevelPathfinder::is_supported(int32_t x, int32_t y) const
+{
+    if (tiles[y * width + x] == TileClass::Climbable || y == 0)
+    {
+        return true;
+    }
+    const TileClass below = tiles[(y - 1) * width + x];
+    return below == TileClass::Solid || below == TileClass::Platform;
+}
+
+template <class FunT>
+void LevelPathfinder::for_each_move(uint32_t tile, bool walking, FunT&& fun) const
+{
+    const int32_t x = tile % width;
+    const int32_t y = tile / width;
+    auto try_move = [&](int32_t to_x, int32_t to_y)
+    {
+        if (is_open(to_x, to_y))
+            fun(static_cast<uint32_t>(to_y * width + to_x));
+    };
+
+    if (!walking)
+    {
+        try_move(x - 1, y);
+        try_move(x + 1, y);
+        try_move(x, y - 1);
+        try_move(x, y + 1);
+        return;
+    }
+
+    try_move(x, y - 1);
+    if (is_supported(x, y))
+    {
+        try_move(x - 1, y);
+        try_move(x + 1, y);
+        if (is_open(x, y + 1))
+        {
+            try_move(x, y + 1);
+            try_move(x - 1, y + 1);
+            try_move(x + 1, y + 1);
+        }
+    }
+}
+
+bool LevelPathfinder::has_move(uint32_t from, uint32_t to, bool walking) const
+{
+    bool found = false;
+    for_each_move(from, walking, [&](uint32_t tile)
+                  { found = found || tile == to; });
+    return found;
+}
+
+void LevelPathfinder::compute_flow_field(FlowField& field) const
+{
+    field.distances.assign(width * height, unreachable);
+    field.stale = false;
+    if (!is_open(field.target % width, field.target / width))
+    {
+        return;
+    }
+
+    // Breadth first search backwards from the target, every move costs the same
+    std::deque<uint32_t> queue{field.target};
+    field.distances[field.target] = 0;
+    while (!queue.empty())
+    {
+        const uint32_t tile = queue.front();
+        queue.pop_front();
+        const int32_t x = tile % width;
+        const int32_t y = tile / width;
+        for (int32_t from_y = y - 1; from_y <= y + 1; from_y++)
+        {
+            for (int32_t from_x = x - 1; from_x <= x + 1; from_x++)
+            {
+                if (!is_open(from_x, from_y))
+                    continue;
+                const uint32_t from = from_y * width + from_x;
+                if (field.distances[from] == unreachable && has_move(from, tile, field.walking))
+                {
+                    field.distances[from] = field.distances[tile] + 1;
+                    queue.push_back(from);
+                }
+            }
+        }
+    }
+}
+
+void LevelPathfinder::repair_flow_field(FlowField& field, const std::vector<uint32_t>& opened) const
+{
+    // Only used for flying, where moves go both ways and opened tiles can only make distances shorter, so it is enough
+    // to push the shorter distances out from the opened tiles
+    std::deque<uint32_t> queue;
+    for (uint32_t tile : opened)
+    {
+        for_each_move(tile, false, [&](uint32_t next)
+                      {
+                          if (field.distances[next] != unreachable)
+                              field.distances[tile] = std::min(field.distances[tile], field.distances[next] + 1);
+                      });
+        if (field.distances[tile] != unreachable)
+            queue.push_back(tile);
+    }
+    while (!queue.empty())
+    {
+        const uint32_t tile = queue.front();
+        queue.pop_front();
+        for_each_move(tile, false, [&](uint32_t next)
+                      {
+                          if (field.distances[tile] + 1 < field.distances[next])
+                          {
+                              field.distances[next] = field.distances[tile] + 1;
+                              queue.push_back(next);
+                          }
+                      });
+    }
+}
+
+LevelPathfinder::FlowField& LevelPathfinder::get_flow_field(uint32_t target, bool walking)
+{
+    auto it = std::find_if(flow_fields.begin(), flow_fields.end(), [&](const FlowField& field)
+                           { return field.target == target && field.walking == walking; });
+    if (it == flow_fields.end())
+    {
+        if (flow_fields.size() < max_flow_fields)
+        {
+            it = flow_fields.insert(flow_fields.end(), FlowField{});
+        }
+        else
+        {
+            it = std::min_element(flow_fields.begin(), flow_fields.end(), [](const FlowField& a, const FlowField& b)
+                                  { return a.last_use < b.last_use; });
+        }
+        it->target = target;
+        it->walking = walking;
+        it->stale = true;
+    }
+    if (it->stale)
+    {
+        compute_flow_field(*it);
+    }
+    it->last_use = ++use_counter;
+    return *it;
+}
+
+uint32_t LevelPathfinder::get_distance(uint32_t tile, uint32_t target, bool walking)
+{
+    if (tile >= width * height || target >= width * height)
+    {
+        return unreachable;
+    }
+    return get_flow_field(target, walking).distances[tile];
+}
+
+std::optional<uint32_t> LevelPathfinder::get_next_tile(uint32_t tile, uint32_t target, bool walking)
+{
+    if (tile >= width * height || target >= width * height)
+    {
+        return std::nullopt;
+    }
+    const FlowField& field = get_flow_field(target, walking);
+    const uint32_t distance = field.distances[tile];
+    if (distance == 0 || distance == unreachable)
+    {
+        return std::nullopt;
+    }
+    std::optional<uint32_t> next;
+    for_each_move(tile, walking, [&](uint32_t to)
+                  {
+                      if (!next.has_value() && field.distances[to] == distance - 1)
+                          next = to;
+                  });
+    return next;
+}
+
+std::vector<uint32_t> LevelPathfinder::find_path(uint32_t start, uint32_t goal, bool walking)
+{
+    if (start >= width * height || goal >= width * height || !is_open(start % width, start / width) || !is_open(goal % width, goal / width))
+    {
+        return {};
+    }
+    for (const CachedPath& path : cached_paths)
+    {
+        if (path.start == start && path.goal == goal && path.walking == walking)
+            return path.tiles;
+    }
+
+    if (stamps.empty())
+    {
+        costs.resize(width * height);
+        parents.resize(width * height);
+        stamps.resize(width * height, 0);
+    }
+    if (++search_stamp == 0)
+    {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        search_stamp = 1;
+    }
+
+    // Walking has diagonal moves, so only the larger of the two axis distances is a lower bound of the moves left
+    const int32_t goal_x = goal % width;
+    const int32_t goal_y = goal / width;
+    auto heuristic = [&](uint32_t tile)
+    {
+        const uint32_t dx = std::abs((int32_t)(tile % width) - goal_x);
+        const uint32_t dy = std::abs((int32_t)(tile / width) - goal_y);
+        return walking ? std::max(dx, dy) : dx + dy;
+    };
+
+    using OpenEntry = std::pair<uint32_t, uint32_t>; // estimated total cost, tile
+    std::vector<OpenEntry> open;
+    auto push = [&](uint32_t tile, uint32_t cost, uint32_t parent)
+    {
+        if (stamps[tile] == search_stamp && costs[tile] <= cost)
+            return;
+        stamps[tile] = search_stamp;
+        costs[tile] = cost;
+        parents[tile] = parent;
+        open.push_back({cost + heuristic(tile), tile});
+        std::push_heap(open.begin(), open.end(), std::greater<>{});
+    };
+
+    push(start, 0, start);
+    bool found = false;
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), std::greater<>{});
+        const auto [estimate, tile] = open.back();
+        open.pop_back();
+        // Tiles are pushed again when a cheaper way to them is found, the old entries are skipped
+        if (estimate != costs[tile] + heuristic(tile))
+            continue;
+        if (tile == goal)
+        {
+            found = true;
+            break;
+        }
+        for_each_move(tile, walking, [&](uint32_t next)
+                      { push(next, costs[tile] + 1, tile); });
+    }
+
+    std::vector<uint32_t> path;
+    if (found)
+    {
+        for (uint32_t tile = goal; tile != start; tile = parents[tile])
+            path.push_back(tile);
+        path.push_back(start);
+        std::reverse(path.begin(), path.end());
+    }
+
+    if (cached_paths.size() >= max_cached_paths)
+    {
+        cached_paths.erase(cached_paths.begin());
+    }
+    cached_paths.push_back({start, goal, walking, path});
+    return path;
+}
+
+struct LayerPathfinder
+{
+    LevelPathfinder pathfinder;
+    std::optional<uint32_t> updated_frame;
+    uint64_t updated_generation{0};
+};
+std::array<LayerPathfinder, 2> g_layer_pathfinders;
+
+LevelPathfinder& get_level_pathfinder(LAYER layer)
+{
+    auto& state = State::get();
+    const uint8_t actual_layer = enum_to_layer(layer);
+    LayerPathfinder& layer_pathfinder = g_layer_pathfinders[actual_layer];
+    // Spawning, destroying or removing floors from a script bumps the entity index generation, so a path asked for right
+    // after that in the same frame already sees the change
+    const uint32_t frame = state.get_frame_count();
+    const uint64_t generation = get_entity_index_generation();
+    if (layer_pathfinder.updated_frame != frame || layer_pathfinder.updated_generation != generation)
+    {
+        layer_pathfinder.pathfinder.update(state.layer(actual_layer));
+        layer_pathfinder.updated_frame = frame;
+        layer_pathfinder.updated_generation = generation;
+    }
+    return layer_pathfinder.pathfinder;
+}
+
+std::vector<uint32_t> find_path(float x1, float y1, float x2, float y2, LAYER layer, bool walking)
+{
+    const auto tiles = get_level_pathfinder(layer).find_path(LevelPathfinder::tile_of(x1, y1), LevelPathfinder::tile_of(x2, y2), walking);
+    std::vector<uint32_t> coordinates;
+    coordinates.reserve(tiles.size() * 2);
+    for (uint32_t tile : tiles)
+    {
+        coordinates.push_back(tile % LevelPathfinder::width);
+        coordinates.push_back(tile / LevelPathfinder::width);
+    }
+    return coordinates;
+}
+
+std::pair<int32_t, int32_t> get_path_direction(float x, float y, float target_x, float target_y, LAYER layer, bool walking)
+{
+    const uint32_t tile = LevelPathfinder::tile_of(x, y);
+    if (auto next = get_level_pathfinder(layer).get_next_tile(tile, LevelPathfinder::tile_of(target_x, target_y), walking))
+    {
+        return {
+            (int32_t)(next.value() % LevelPathfinder::width) - (int32_t)(tile % LevelPathfinder::width),
+            (int32_t)(next.value() / LevelPathfinder::width) - (int32_t)(tile / LevelPathfinder::width),
+        };
+    }
+    return {0, 0};
+}
+
+int32_t get_path_distance(float x, float y, float target_x, float target_y, LAYER layer, bool walking)
+{
+    const uint32_t distance = get_level_pathfinder(layer).get_distance(LevelPathfinder::tile_of(x, y), LevelPathfinder::tile_of(target_x, target_y), walking);
+    return distance == LevelPathfinder::unreachable ? -1 : static_cast<int32_t>(distance);
+}
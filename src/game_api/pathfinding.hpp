@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "aliases.hpp"
+
+struct Layer;
+
+// Walkability graph over Layer::grid_entities, answers A* queries and keeps flow fields toward targets
+// Tiles are classified from the flags of their grid entity, the graph is either free movement between neighbouring open
+// tiles or a simple platformer model where only supported tiles allow moving sideways:
+// - a tile is supported if it is climbable or stands on a solid tile or a platform
+// - from a supported tile one can walk left and right, jump one tile up and diagonally up onto a ledge
+// - from a climbable tile one can climb up, from every tile one can fall or climb down
+class LevelPathfinder
+{
+  public:
+    static constexpr uint32_t width = 0x56;
+    static constexpr uint32_t height = 0x7e;
+    static constexpr uint32_t unreachable = UINT32_MAX;
+
+    // Re-classifies all tiles, flow fields are repaired in place if tiles only opened up and recomputed on their next use
+    // otherwise, returns the number of tiles that changed
+    size_t update(Layer* layer);
+
+    // Tiles on the shortest path from start to goal including both ends, empty if goal can't be reached
+    std::vector<uint32_t> find_path(uint32_t start, uint32_t goal, bool walking);
+    // Number of moves from tile to target, or unreachable
+    uint32_t get_distance(uint32_t tile, uint32_t target, bool walking);
+    // The next tile on a shortest path from tile to target, nullopt if tile is the target or the target can't be reached
+    std::optional<uint32_t> get_next_tile(uint32_t tile, uint32_t target, bool walking);
+
+    static uint32_t tile_of(float x, float y);
+
+  private:
+    enum class TileClass : uint8_t
+    {
+        Open,
+        Climbable,
+        Platform,
+        Solid,
+    };
+
+    struct FlowField
+    {
+        uint32_t target;
+        bool walking;
+        bool stale;
+        uint64_t last_use;
+        std::vector<uint32_t> distances;
+    };
+
+    struct CachedPath
+    {
+        uint32_t start;
+        uint32_t goal;
+        bool walking;
+        std::vector<uint32_t> tiles;
+    };
+
+    // Flow fields and paths are kept for this many different targets and queries, the least recently used is replaced
+    static constexpr size_t max_flow_fields = 8;
+    static constexpr size_t max_cached_paths = 64;
+
+    bool is_open(int32_t x, int32_t y) const;
+    bool is_supported(int32_t x, int32_t y) const;
+
+    template <class FunT>
+    void for_each_move(uint32_t tile, bool walking, FunT&& fun) const;
+    bool has_move(uint32_t from, uint32_t to, bool walking) const;
+
+    FlowField& get_flow_field(uint32_t target, bool walking);
+    void compute_flow_field(FlowField& field) const;
+    void repair_flow_field(FlowField& field, const std::vector<uint32_t>& opened) const;
+
+    std::array<TileClass, width * height> tiles{};
+    std::vector<FlowField> flow_fields;
+    std::vector<CachedPath> cached_paths;
+    uint64_t use_counter{0};
+
+    // Scratch memory of find_path, a tile is only valid in costs and parents if its stamp is the current search
+    std::vector<uint32_t> costs;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> stamps;
+    uint32_t search_stamp{0};
+};
+
+// Pathfinder of the layer, updated from the grid once per frame and again whenever the entity index is invalidated
+LevelPathfinder& get_level_pathfinder(LAYER layer);
+
+// Tile coordinates x, y of every tile on the path, one after the other, empty if there is no path
+std::vector<uint32_t> find_path(float x1, float y1, float x2, float y2, LAYER layer, bool walking);
+// Direction of the first move from x, y toward target_x, target_y as tile offsets, 0, 0 if there is none
+std::pair<int32_t, int32_t> get_path_direction(float x, float y, float target_x, float target_y, LAYER layer, bool walking);
+// Number of moves from x, y to target_x, target_y, -1 if it can't be reached
+int32_t get_path_distance(float x, float y, float target_x, float target_y, LAYER layer, bool walking);
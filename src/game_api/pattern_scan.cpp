@@ -0,0 +1,266 @@
+#include "pattern_scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define PATTERN_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define PATTERN_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+// Bytes that are very common in x64 code, ordered from most to least common
+// Everything not in this list is considered rare, which makes it a good candidate for the prefilter
+constexpr std::array<uint8_t, 40> g_common_code_bytes{
+    0x00, 0xff, 0x48, 0x8b, 0x89, 0x0f, 0x24, 0x44, 0x4c, 0x8d,
+    0xe8, 0x83, 0x01, 0x45, 0x85, 0xc0, 0x08, 0x10, 0x20, 0x41,
+    0x49, 0x74, 0x75, 0xcc, 0x30, 0x28, 0x18, 0x84, 0xc3, 0x33,
+    0xeb, 0x40, 0x4d, 0x05, 0x15, 0x0d, 0x02, 0x04, 0x03, 0xc7};
+
+constexpr std::array<uint8_t, 256> make_byte_commonness()
+{
+    std::array<uint8_t, 256> commonness{};
+    for (size_t i = 0; i < g_common_code_bytes.size(); i++)
+    {
+        commonness[g_common_code_bytes[i]] = static_cast<uint8_t>(g_common_code_bytes.size() - i);
+    }
+    return commonness;
+}
+constexpr std::array<uint8_t, 256> g_byte_commonness = make_byte_commonness();
+
+inline uint32_t count_trailing_zeros(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+} // namespace
+
+PatternScanner::PatternScanner(std::string_view pattern)
+    : needle{pattern}
+{
+    auto pick_anchor = [this](size_t skip)
+    {
+        size_t best = npos;
+        for (size_t i = 0; i < needle.size(); i++)
+        {
+            if (i == skip || needle[i] == '*')
+            {
+                continue;
+            }
+            if (best == npos || g_byte_commonness[(uint8_t)needle[i]] < g_byte_commonness[(uint8_t)needle[best]])
+            {
+                best = i;
+            }
+        }
+        return best;
+    };
+    first_anchor = pick_anchor(npos);
+    if (first_anchor != npos)
+    {
+        second_anchor = pick_anchor(first_anchor);
+    }
+}
+
+std::optional<size_t> PatternScanner::find(const char* data, size_t start, size_t end) const
+{
+    if (end < needle.size() || start > end - needle.size())
+    {
+        return std::nullopt;
+    }
+
+    // Candidates are all offsets in [start, last]
+    const size_t last = end - needle.size();
+    if (first_anchor == npos)
+    {
+        return start;
+    }
+
+    if (auto hit = find_simd(data, start, last))
+    {
+        return hit;
+    }
+    return find_scalar(data, start, last);
+}
+
+std::optional<size_t> PatternScanner::find_scalar(const char* data, size_t start, size_t last) const
+{
+    // Let memchr find the next occurrence of the anchor byte, then verify the rest of the pattern around it
+    const char anchor_byte = needle[first_anchor];
+    size_t candidate = start;
+    while (candidate <= last)
+    {
+        const void* found = std::memchr(data + candidate + first_anchor, anchor_byte, last - candidate + 1);
+        if (found == nullptr)
+        {
+            break;
+        }
+        candidate = static_cast<size_t>(static_cast<const char*>(found) - data) - first_anchor;
+        if (matches_at(data + candidate))
+        {
+            return candidate;
+        }
+        candidate++;
+    }
+    return std::nullopt;
+}
+
+// Compares the two anchor bytes for a whole block of candidates at once, only candidates where both anchors match are
+// verified byte by byte, on return start points to the first candidate that was not processed yet
+std::optional<size_t> PatternScanner::find_simd(const char* data, size_t& start, size_t last) const
+{
+    const size_t second = second_anchor != npos ? second_anchor : first_anchor;
+
+#ifdef PATTERN_SCAN_AVX2
+    {
+        const __m256i first_byte = _mm256_set1_epi8(needle[first_anchor]);
+        const __m256i second_byte = _mm256_set1_epi8(needle[second]);
+        for (; start + 32 <= last; start += 32)
+        {
+            const __m256i first_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + start + first_anchor));
+            const __m256i second_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + start + second));
+            const __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(first_block, first_byte), _mm256_cmpeq_epi8(second_block, second_byte));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(both));
+            while (mask != 0)
+            {
+                const size_t candidate = start + count_trailing_zeros(mask);
+                if (matches_at(data + candidate))
+                {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+        }
+    }
+#endif
+
+#ifdef PATTERN_SCAN_SSE2
+    {
+        const __m128i first_byte = _mm_set1_epi8(needle[first_anchor]);
+        const __m128i second_byte = _mm_set1_epi8(needle[second]);
+        for (; start + 16 <= last; start += 16)
+        {
+            const __m128i first_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + start + first_anchor));
+            const __m128i second_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + start + second));
+            const __m128i both = _mm_and_si128(_mm_cmpeq_epi8(first_block, first_byte), _mm_cmpeq_epi8(second_block, second_byte));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(both));
+            while (mask != 0)
+            {
+                const size_t candidate = start + count_trailing_zeros(mask);
+                if (matches_at(data + candidate))
+                {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+        }
+    }
+#else
+    (void)data;
+    (void)last;
+    (void)second;
+#endif
+
+    return std::nullopt;
+}
+
+std::optional<size_t> scan_pattern(const char* data, std::string_view pattern, size_t start, size_t end)
+{
+    return PatternScanner{pattern}.find(data, start, end);
+}
+
+size_t MultiPatternScanner::add(std::string_view pattern)
+{
+    if (auto it = pattern_indices.find(pattern); it != pattern_indices.end())
+    {
+        return it->second;
+    }
+
+    const size_t pattern_index = patterns.size();
+    patterns.emplace_back(pattern);
+    pattern_indices[pattern] = pattern_index;
+    longest = std::max(longest, pattern.size());
+
+    std::optional<size_t> best_offset;
+    uint32_t best_commonness = 0;
+    for (size_t i = 0; i + 1 < pattern.size(); i++)
+    {
+        if (pattern[i] == '*' || pattern[i + 1] == '*')
+        {
+            continue;
+        }
+        const uint32_t commonness = g_byte_commonness[(uint8_t)pattern[i]] + g_byte_commonness[(uint8_t)pattern[i + 1]];
+        if (!best_offset.has_value() || commonness < best_commonness)
+        {
+            best_offset = i;
+            best_commonness = commonness;
+        }
+    }
+
+    if (!best_offset.has_value())
+    {
+        unkeyed_patterns.push_back(pattern_index);
+    }
+    else
+    {
+        const size_t key_offset = best_offset.value();
+        const uint16_t key = (uint16_t)((uint8_t)pattern[key_offset] | ((uint8_t)pattern[key_offset + 1] << 8));
+        key_filter[key / 64] |= 1ull << (key % 64);
+        keyed_patterns[key].push_back({pattern_index, key_offset});
+    }
+
+    return pattern_index;
+}
+
+std::vector<std::optional<size_t>> MultiPatternScanner::find_all(const char* data, size_t start, size_t end) const
+{
+    std::vector<std::optional<size_t>> hits(patterns.size());
+
+    for (size_t pattern_index : unkeyed_patterns)
+    {
+        hits[pattern_index] = patterns[pattern_index].find(data, start, end);
+    }
+
+    size_t remaining = patterns.size() - unkeyed_patterns.size();
+    for (size_t position = start; remaining > 0 && position + 1 < end; position++)
+    {
+        uint16_t key;
+        std::memcpy(&key, data + position, sizeof(key));
+        if ((key_filter[key / 64] & (1ull << (key % 64))) == 0)
+        {
+            continue;
+        }
+
+        // Candidates are visited in increasing order per pattern, so the first hit is always the earliest one
+        for (const auto& [pattern_index, key_offset] : keyed_patterns.at(key))
+        {
+            const PatternScanner& pattern = patterns[pattern_index];
+            if (hits[pattern_index].has_value() || position < start + key_offset || position - key_offset + pattern.size() > end)
+            {
+                continue;
+            }
+
+            const size_t candidate = position - key_offset;
+            if (pattern.matches_at(data + candidate))
+            {
+                hits[pattern_index] = candidate;
+                remaining--;
+            }
+        }
+    }
+
+    return hits;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Portable core of the signature scanner used by find_inst, has no dependency on Windows or the game so it can be
+// used (and benchmarked) against any image that was loaded into memory, e.g. a Spel2.exe dumped to disk
+//
+// Patterns use the same syntax as find_inst: every '*' (\x2a) matches any byte, all other bytes have to match exactly
+class PatternScanner
+{
+  public:
+    PatternScanner() = default;
+    explicit PatternScanner(std::string_view pattern);
+
+    std::string_view pattern() const
+    {
+        return needle;
+    }
+    size_t size() const
+    {
+        return needle.size();
+    }
+
+    // Returns the offset of the first match that lies completely inside [start, end) of data
+    std::optional<size_t> find(const char* data, size_t start, size_t end) const;
+
+    // Checks whether the pattern matches at data[0..size()), data has to be at least size() bytes long
+    bool matches_at(const char* data) const
+    {
+        for (size_t i = 0; i < needle.size(); i++)
+        {
+            if (needle[i] != '*' && needle[i] != data[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Index of the rarest non-wildcard byte in the pattern, this byte is used to prefilter candidates
+    // Is std::nullopt if the pattern consists of wildcards only
+    std::optional<size_t> anchor() const
+    {
+        if (first_anchor == npos)
+        {
+            return std::nullopt;
+        }
+        return first_anchor;
+    }
+
+  private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::optional<size_t> find_scalar(const char* data, size_t start, size_t last) const;
+    std::optional<size_t> find_simd(const char* data, size_t& start, size_t last) const;
+
+    std::string_view needle;
+    size_t first_anchor{npos};
+    size_t second_anchor{npos};
+};
+
+// Searches for many patterns at once in a single linear pass over the data
+// Every pattern is keyed by its rarest pair of consecutive non-wildcard bytes, each position of the data is then
+// checked against a 64k bit filter of those keys and only the few candidates that pass it are verified
+class MultiPatternScanner
+{
+  public:
+    // Returns the index of the pattern, adding the same pattern twice returns the same index
+    size_t add(std::string_view pattern);
+    size_t size() const
+    {
+        return patterns.size();
+    }
+    // Size of the longest added pattern, callers that split the data into chunks have to overlap them by this - 1
+    size_t longest_pattern() const
+    {
+        return longest;
+    }
+
+    // Returns the first match of every added pattern that lies completely inside [start, end) of data, indexed like add
+    std::vector<std::optional<size_t>> find_all(const char* data, size_t start, size_t end) const;
+
+  private:
+    struct KeyedPattern
+    {
+        size_t pattern_index;
+        size_t key_offset;
+    };
+
+    std::vector<PatternScanner> patterns;
+    std::unordered_map<std::string_view, size_t> pattern_indices;
+    size_t longest{0};
+    std::array<uint64_t, 0x10000 / 64> key_filter{};
+    std::unordered_map<uint16_t, std::vector<KeyedPattern>> keyed_patterns;
+    // Patterns without two consecutive non-wildcard bytes, these are searched for one by one
+    std::vector<size_t> unkeyed_patterns;
+};
+
+// Convenience wrapper around PatternScanner for one-off searches
+std::optional<size_t> scan_pattern(const char* data, std::string_view pattern, size_t start, size_t end);
@@ -6,13 +6,19 @@
 #include "entities_liquids.hpp"
 #include "entities_mounts.hpp"
 #include "entity.hpp"
+#include "entity_index.hpp"
+#include "entity_type_set.hpp"
 #include "game_manager.hpp"
 #include "level_api.hpp"
 #include "logger.h"
+#include "pattern_scan.hpp"
 #include "state.hpp"
 #include "virtual_table.hpp"
+#include <algorithm>
+#include <array>
 #include <cstdarg>
 #include <detours.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
@@ -165,33 +171,9 @@ int32_t get_entity_at(float x, float y, bool s, float radius, uint32_t mask) //
     auto player = state.items()->player(0);
     if (player == nullptr)
         return -1;
-    std::vector<std::tuple<int32_t, float, Entity*>> found;
-    for (auto& item : state.layer(player->layer)->all_entities)
-    {
-        auto [ix, iy] = item->position();
-        auto flags = item->type->search_flags;
-        float distance = sqrt(pow(x - ix, 2.0f) + pow(y - iy, 2.0f));
-        if (((mask & flags) > 0 || mask == 0) && distance < radius)
-        {
-            /*DEBUG(
-                "Item {}, {:x} type, {} position, {} distance, {:x}",
-                item->uid,
-                item->type->search_flags,
-                item->position_self(),
-                distance,
-                item->pointer());*/
-            found.push_back({item->uid, distance, item});
-        }
-    }
+    auto found = get_nearest_entities(x, y, static_cast<LAYER>(player->layer), {}, mask, 1, radius);
     if (!found.empty())
-    {
-        std::sort(found.begin(), found.end(), [](auto a, auto b) -> bool
-                  { return std::get<1>(a) < std::get<1>(b); });
-        auto picked = found[0];
-        //auto entity = std::get<2>(picked);
-        //DEBUG("{}", (void*)entity);
-        return std::get<0>(picked);
-    }
+        return found[0];
     return -1;
 }
 
@@ -239,6 +221,7 @@ void move_liquid_abs(uint32_t uid, float x, float y, float vx, float vy)
         {
             liquid_engine->entity_coordinates[*entity->liquid_id] = {x, y};
             liquid_engine->entity_velocities[*entity->liquid_id] = {vx, vy};
+            invalidate_entity_index();
         }
     }
 }
@@ -427,12 +410,37 @@ Screen* get_screen_ptr(uint32_t screen_id)
     return nullptr;
 }
 
+// Direct-mapped cache of the slots in uid_to_entity_data where uids were last found
+// A hit is verified against the table itself, so entities that were destroyed or moved around by the table just miss and
+// nothing has to be invalidated on spawns or destroys
+struct EntityLookupCacheEntry
+{
+    uint32_t uid_plus_one{0};
+    uint32_t slot{0};
+    Entity* entity{nullptr};
+};
+thread_local std::array<EntityLookupCacheEntry, 0x1000> g_entity_lookup_cache{};
+
 Entity* get_entity_ptr(uint32_t uid)
 {
-    auto state = State::get();
-    auto p = state.find(uid);
+    auto& state = State::get();
+    EntityLookupCacheEntry& cached = g_entity_lookup_cache[uid & (g_entity_lookup_cache.size() - 1)];
+    if (cached.entity != nullptr && cached.uid_plus_one == uid + 1)
+    {
+        const StateMemory* state_ptr = state.ptr();
+        if (cached.slot <= state_ptr->uid_to_entity_mask)
+        {
+            const RobinHoodTableEntry& entry = state_ptr->uid_to_entity_data[cached.slot];
+            if (entry.uid_plus_one == cached.uid_plus_one && entry.entity == cached.entity)
+                return cached.entity;
+        }
+    }
+
+    size_t slot;
+    auto p = state.find(uid, slot);
     if (IsBadWritePtr(p, 0x178))
         return nullptr;
+    cached = {uid + 1, static_cast<uint32_t>(slot), p};
     return p;
 }
 
@@ -526,21 +534,180 @@ std::vector<uint32_t> get_entities_by_mask(uint32_t mask)
     return get_entities_by({}, mask, LAYER::BOTH);
 }
 
-std::vector<uint32_t> get_entities_by(std::vector<ENT_TYPE> entity_types, uint32_t mask, LAYER layer)
+enum class EntityQueryKind : uint8_t
+{
+    By,
+    At,
+    OverlappingHitbox,
+};
+struct EntityQueryKey
+{
+    EntityQueryKind kind;
+    uint8_t layer;
+    uint32_t mask;
+    std::array<float, 4> region;
+    bool all_types;
+    std::vector<ENT_TYPE> types;
+
+    bool operator==(const EntityQueryKey&) const = default;
+};
+struct EntityQueryKeyHash
+{
+    size_t operator()(const EntityQueryKey& key) const
+    {
+        size_t hash = std::hash<uint64_t>{}(((uint64_t)key.kind << 40) | ((uint64_t)key.layer << 32) | key.mask);
+        auto combine = [&hash](size_t value)
+        { hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2); };
+        for (float value : key.region)
+            combine(std::hash<float>{}(value));
+        for (ENT_TYPE type : key.types)
+            combine(type);
+        return hash;
+    }
+};
+struct EntityQueryCache
 {
+    bool enabled{false};
+    uint32_t frame{0};
+    uint64_t generation{0};
+    std::array<uint32_t, 2> layer_sizes{};
+    std::unordered_map<EntityQueryKey, std::vector<uint32_t>, EntityQueryKeyHash> results;
+};
+thread_local EntityQueryCache* g_active_entity_query_cache{nullptr};
+
+std::shared_ptr<EntityQueryCache> make_entity_query_cache()
+{
+    return std::make_shared<EntityQueryCache>();
+}
+void set_entity_query_cache_enabled(EntityQueryCache& cache, bool enabled)
+{
+    cache.enabled = enabled;
+    cache.results.clear();
+}
+EntityQueryCache* set_active_entity_query_cache(EntityQueryCache* cache)
+{
+    return std::exchange(g_active_entity_query_cache, cache);
+}
+void release_entity_query_cache(const EntityQueryCache* cache)
+{
+    if (g_active_entity_query_cache == cache)
+        g_active_entity_query_cache = nullptr;
+}
+
+// Returns the result of an identical earlier query in the same frame if the active cache is enabled, otherwise runs it
+template <class QueryT>
+std::vector<uint32_t> cached_entity_query(EntityQueryKind kind, const EntityTypeSet& entity_types, uint32_t mask, LAYER layer, std::array<float, 4> region, QueryT&& query)
+{
+    if (g_active_entity_query_cache == nullptr || !g_active_entity_query_cache->enabled)
+        return query();
+    EntityQueryCache& cache = *g_active_entity_query_cache;
+
+    // Spawns, removals and teleports bump the index generation, destroyed entities change the layer sizes
     auto state = State::get();
-    std::vector<uint32_t> found;
-    const std::vector<ENT_TYPE> proper_types = get_proper_types(std::move(entity_types));
-    auto push_entities = [&mask, &proper_types, &found, &state](uint8_t l)
+    const uint32_t frame = state.get_frame_count();
+    const uint64_t generation = get_entity_index_generation();
+    const std::array<uint32_t, 2> layer_sizes{state.layer(0)->all_entities.size, state.layer(1)->all_entities.size};
+    if (cache.frame != frame || cache.generation != generation || cache.layer_sizes != layer_sizes)
+    {
+        cache.results.clear();
+        cache.frame = frame;
+        cache.generation = generation;
+        cache.layer_sizes = layer_sizes;
+    }
+
+    // Player relative layers are resolved so the key stays valid if a player changes layers
+    EntityQueryKey key{
+        kind,
+        layer == LAYER::BOTH ? uint8_t(0xff) : enum_to_layer(layer),
+        mask,
+        region,
+        entity_types.matches_all(),
+        std::vector<ENT_TYPE>(entity_types.types().begin(), entity_types.types().end()),
+    };
+    auto [it, inserted] = cache.results.try_emplace(std::move(key));
+    if (inserted)
+        it->second = query();
+    return it->second;
+}
+
+void for_each_entity_by(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer, EntityVisitor visitor)
+{
+    auto state = State::get();
+    auto visit_layer = [&mask, &entity_types, &visitor, &state](uint8_t l)
     {
+        // Whole types are either taken or skipped, since all entities of a type share their search_flags
+        // Entities of several types are visited in the order of all_entities, the same as the linear scan below
+        if (const EntityTypeBuckets* buckets = get_entity_type_buckets(state.layer(l)))
+        {
+            // The buckets are merged by their list order through a heap of cursors on the stack, queries taking more
+            // types than fit are left to the linear scan, they cover a big part of the layer anyway
+            struct BucketCursor
+            {
+                const uint32_t* order;
+                const uint32_t* orders_end;
+                Entity* const* entity;
+            };
+            constexpr size_t max_merged_types = 64;
+            std::array<BucketCursor, max_merged_types> cursors;
+            size_t num_cursors = 0;
+            bool too_many_types = false;
+            for (ENT_TYPE type : entity_types.matches_all() ? buckets->present_types() : entity_types.types())
+            {
+                if (buckets->entities_of(type).empty() || (mask != 0 && !(buckets->search_flags_of(type) & mask)))
+                    continue;
+                if (num_cursors == max_merged_types)
+                {
+                    too_many_types = true;
+                    break;
+                }
+                std::span<const uint32_t> orders = buckets->orders_of(type);
+                cursors[num_cursors++] = {orders.data(), orders.data() + orders.size(), buckets->entities_of(type).data()};
+            }
+
+            if (!too_many_types)
+            {
+                // Min-heap on the list order of the next entity of every bucket
+                auto later = [](const BucketCursor& lhs, const BucketCursor& rhs)
+                { return *lhs.order > *rhs.order; };
+                std::make_heap(cursors.begin(), cursors.begin() + num_cursors, later);
+                while (num_cursors > 0)
+                {
+                    std::pop_heap(cursors.begin(), cursors.begin() + num_cursors, later);
+                    BucketCursor& cursor = cursors[num_cursors - 1];
+                    visitor(*cursor.entity);
+                    cursor.entity++;
+                    if (++cursor.order == cursor.orders_end)
+                        num_cursors--;
+                    else
+                        std::push_heap(cursors.begin(), cursors.begin() + num_cursors, later);
+                }
+                return;
+            }
+        }
+
         for (auto& item : state.layer(l)->all_entities)
-            if ((mask == 0 || (item->type->search_flags & mask)) && entity_type_check(proper_types, item->type->id))
-                found.push_back(item->uid);
+            if ((mask == 0 || (item->type->search_flags & mask)) && entity_types.contains(item->type->id))
+                visitor(item);
     };
 
     if (layer == LAYER::BOTH)
     {
-        if ((!proper_types.size() || !proper_types[0]) && !mask) // all entities
+        visit_layer(0);
+        visit_layer(1);
+    }
+    else
+    {
+        visit_layer(enum_to_layer(layer));
+    }
+}
+
+std::vector<uint32_t> get_entities_by_uncached(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer)
+{
+    auto state = State::get();
+    std::vector<uint32_t> found;
+    if (entity_types.matches_all() && !mask) // all entities
+    {
+        if (layer == LAYER::BOTH)
         {
             found.reserve((size_t)state.layer(0)->all_entities.size + (size_t)state.layer(1)->all_entities.size);
             found.insert(found.end(), state.layer(0)->all_entities.uid_begin(), state.layer(0)->all_entities.uid_end());
@@ -548,109 +715,247 @@ std::vector<uint32_t> get_entities_by(std::vector<ENT_TYPE> entity_types, uint32
         }
         else
         {
-            push_entities(0);
-            push_entities(1);
+            uint8_t correct_layer = enum_to_layer(layer);
+            found.reserve(state.layer(correct_layer)->all_entities.size);
+            found.insert(found.begin(), state.layer(correct_layer)->all_entities.uid_begin(), state.layer(correct_layer)->all_entities.uid_end());
         }
+        return found;
     }
-    else
+
+    for_each_entity_by(entity_types, mask, layer, [&found](Entity* item)
+                       { found.push_back(item->uid); });
+    return found;
+}
+std::vector<uint32_t> get_entities_by(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer)
+{
+    return cached_entity_query(EntityQueryKind::By, entity_types, mask, layer, {}, [&]()
+                               { return get_entities_by_uncached(entity_types, mask, layer); });
+}
+std::vector<uint32_t> get_entities_by(std::vector<ENT_TYPE> entity_types, uint32_t mask, LAYER layer)
+{
+    return get_entities_by(EntityTypeSet{entity_types}, mask, layer);
+}
+std::vector<uint32_t> get_entities_by(ENT_TYPE entity_type, uint32_t mask, LAYER layer)
+{
+    return get_entities_by(EntityTypeSet{entity_type}, mask, layer);
+}
+void get_entity_properties_by(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer, bool use_render_pos, EntityProperties& out)
+{
+    out.clear();
+    for_each_entity_by(entity_types, mask, layer, [&out, use_render_pos](Entity* item)
+                       { out.push_back(item->uid, item, use_render_pos); });
+}
+
+void for_each_entity_at(const EntityTypeSet& entity_types, uint32_t mask, float x, float y, LAYER layer, float radius, EntityVisitor visitor)
+{
+    auto state = State::get();
+    const float radius_squared = radius * radius;
+    auto visit_entity = [&x, &y, &radius_squared, &mask, &entity_types, &visitor](Entity* item)
     {
-        uint8_t correct_layer = enum_to_layer(layer);
-        if ((!proper_types.size() || !proper_types[0]) && !mask) // all entities
+        if ((mask == 0 || (item->type->search_flags & mask)) && entity_types.contains(item->type->id))
         {
-            found.reserve(state.layer(correct_layer)->all_entities.size);
-            found.insert(found.begin(), state.layer(correct_layer)->all_entities.uid_begin(), state.layer(correct_layer)->all_entities.uid_end());
+            auto [ix, iy] = item->position();
+            if ((x - ix) * (x - ix) + (y - iy) * (y - iy) < radius_squared)
+                visitor(item);
+        }
+    };
+    auto visit_layer = [&x, &y, &radius, &visit_entity, &state](uint8_t l)
+    {
+        if (const EntitySpatialGrid* grid = get_entity_spatial_grid(state.layer(l)))
+        {
+            const float reach = radius + g_entity_index_slack;
+            grid->for_each_candidate(x - reach, y - reach, x + reach, y + reach, visit_entity);
         }
         else
         {
-            push_entities(correct_layer);
+            for (auto& item : state.layer(l)->all_entities)
+                visit_entity(item);
         }
+    };
+    if (layer == LAYER::BOTH)
+    {
+        visit_layer(0);
+        visit_layer(1);
+    }
+    else
+    {
+        visit_layer(enum_to_layer(layer));
     }
-    return found;
 }
-std::vector<uint32_t> get_entities_by(ENT_TYPE entity_type, uint32_t mask, LAYER layer)
+
+std::vector<uint32_t> get_entities_at(const EntityTypeSet& entity_types, uint32_t mask, float x, float y, LAYER layer, float radius)
 {
-    return get_entities_by(std::vector<ENT_TYPE>{entity_type}, mask, layer);
+    return cached_entity_query(EntityQueryKind::At, entity_types, mask, layer, {x, y, radius, 0.0f}, [&]()
+                               {
+                                   std::vector<uint32_t> found;
+                                   for_each_entity_at(entity_types, mask, x, y, layer, radius, [&found](Entity* item)
+                                                      { found.push_back(item->uid); });
+                                   return found; });
 }
-
-std::vector<uint32_t> get_entities_at(std::vector<ENT_TYPE> entity_types, uint32_t mask, float x, float y, LAYER layer, float radius)
+std::vector<uint32_t> get_nearest_entities(float x, float y, LAYER layer, const EntityTypeSet& entity_types, uint32_t mask, uint32_t count, float max_radius)
 {
+    if (count == 0 || !(max_radius > 0.0f))
+        return {};
+
+    // Max-heap of the closest entities seen so far, the farthest one is on top and gets replaced by anything closer
+    std::vector<std::pair<float, Entity*>> closest;
+    closest.reserve(count);
+    auto by_distance = [](const std::pair<float, Entity*>& a, const std::pair<float, Entity*>& b)
+    { return a.first < b.first; };
+
+    const float max_radius_squared = max_radius * max_radius;
+    auto consider = [&](Entity* item)
+    {
+        if ((mask != 0 && !(item->type->search_flags & mask)) || !entity_types.contains(item->type->id))
+            return;
+        auto [ix, iy] = item->position();
+        const float distance_squared = (x - ix) * (x - ix) + (y - iy) * (y - iy);
+        if (!(distance_squared < max_radius_squared))
+            return;
+        if (closest.size() < count)
+        {
+            closest.push_back({distance_squared, item});
+            std::push_heap(closest.begin(), closest.end(), by_distance);
+        }
+        else if (distance_squared < closest.front().first)
+        {
+            std::pop_heap(closest.begin(), closest.end(), by_distance);
+            closest.back() = {distance_squared, item};
+            std::push_heap(closest.begin(), closest.end(), by_distance);
+        }
+    };
+
+    // The grid is walked outwards ring by ring in a single pass, once count entities are found and the next ring is
+    // farther away than the farthest of them nothing that is left can be closer
     auto state = State::get();
-    std::vector<uint32_t> found;
-    const std::vector<ENT_TYPE> proper_types = get_proper_types(std::move(entity_types));
-    auto push_entities = [&x, &y, &radius, &mask, &proper_types, &found, &state](uint8_t l)
+    auto search_layer = [&](uint8_t l)
     {
-        for (auto& item : state.layer(l)->all_entities)
+        if (const EntitySpatialGrid* grid = get_entity_spatial_grid(state.layer(l)))
         {
-            auto [ix, iy] = item->position();
-            float distance = sqrt(pow(x - ix, 2.0f) + pow(y - iy, 2.0f));
-            if ((mask == 0 || (item->type->search_flags & mask)) && distance < radius && entity_type_check(proper_types, item->type->id))
-                found.push_back(item->uid);
+            grid->for_each_nearby(x, y, consider, [&](float distance)
+                                  {
+                                      // Entities may have moved since the grid was built
+                                      const float reach = distance - g_entity_index_slack;
+                                      if (reach >= max_radius)
+                                          return true;
+                                      return reach > 0.0f && closest.size() == count && closest.front().first <= reach * reach; });
+        }
+        else
+        {
+            for (auto& item : state.layer(l)->all_entities)
+                consider(item);
         }
     };
     if (layer == LAYER::BOTH)
     {
-        push_entities(0);
-        push_entities(1);
+        search_layer(0);
+        search_layer(1);
     }
     else
     {
-        push_entities(enum_to_layer(layer));
+        search_layer(enum_to_layer(layer));
     }
+
+    std::sort_heap(closest.begin(), closest.end(), by_distance);
+    std::vector<uint32_t> found;
+    found.reserve(closest.size());
+    for (auto& [distance_squared, item] : closest)
+        found.push_back(item->uid);
     return found;
 }
+
+std::vector<uint32_t> get_entities_at(std::vector<ENT_TYPE> entity_types, uint32_t mask, float x, float y, LAYER layer, float radius)
+{
+    return get_entities_at(EntityTypeSet{entity_types}, mask, x, y, layer, radius);
+}
 std::vector<uint32_t> get_entities_at(ENT_TYPE entity_type, uint32_t mask, float x, float y, LAYER layer, float radius)
 {
-    return get_entities_at(std::vector<ENT_TYPE>{entity_type}, mask, x, y, layer, radius);
+    return get_entities_at(EntityTypeSet{entity_type}, mask, x, y, layer, radius);
 }
 
-std::vector<uint32_t> get_entities_overlapping_hitbox(std::vector<ENT_TYPE> entity_types, uint32_t mask, AABB hitbox, LAYER layer)
+void for_each_entity_overlapping_hitbox(const EntityTypeSet& entity_types, uint32_t mask, AABB hitbox, LAYER layer, EntityVisitor visitor)
 {
     auto state = State::get();
-    std::vector<uint32_t> result;
-    const std::vector<ENT_TYPE> proper_types = get_proper_types(std::move(entity_types));
     if (layer == LAYER::BOTH)
     {
-        std::vector<uint32_t> result2;
-        result = get_entities_overlapping_by_pointer(proper_types, mask, hitbox.left, hitbox.bottom, hitbox.right, hitbox.top, state.layer(0));
-        result2 = get_entities_overlapping_by_pointer(proper_types, mask, hitbox.left, hitbox.bottom, hitbox.right, hitbox.top, state.layer(1));
-        result.insert(result.end(), result2.begin(), result2.end());
+        for_each_entity_overlapping_by_pointer(entity_types, mask, hitbox.left, hitbox.bottom, hitbox.right, hitbox.top, state.layer(0), visitor);
+        for_each_entity_overlapping_by_pointer(entity_types, mask, hitbox.left, hitbox.bottom, hitbox.right, hitbox.top, state.layer(1), visitor);
     }
     else
     {
         uint8_t actual_layer = enum_to_layer(layer);
-        result = get_entities_overlapping_by_pointer(proper_types, mask, hitbox.left, hitbox.bottom, hitbox.right, hitbox.top, state.layer(actual_layer));
+        for_each_entity_overlapping_by_pointer(entity_types, mask, hitbox.left, hitbox.bottom, hitbox.right, hitbox.top, state.layer(actual_layer), visitor);
     }
-    return result;
+}
+
+std::vector<uint32_t> get_entities_overlapping_hitbox(const EntityTypeSet& entity_types, uint32_t mask, AABB hitbox, LAYER layer)
+{
+    return cached_entity_query(EntityQueryKind::OverlappingHitbox, entity_types, mask, layer, {hitbox.left, hitbox.bottom, hitbox.right, hitbox.top}, [&]()
+                               {
+                                   std::vector<uint32_t> result;
+                                   for_each_entity_overlapping_hitbox(entity_types, mask, hitbox, layer, [&result](Entity* item)
+                                                                      { result.push_back(item->uid); });
+                                   return result; });
+}
+std::vector<uint32_t> get_entities_overlapping_hitbox(std::vector<ENT_TYPE> entity_types, uint32_t mask, AABB hitbox, LAYER layer)
+{
+    return get_entities_overlapping_hitbox(EntityTypeSet{entity_types}, mask, hitbox, layer);
 }
 std::vector<uint32_t> get_entities_overlapping_hitbox(ENT_TYPE entity_type, uint32_t mask, AABB hitbox, LAYER layer)
 {
-    return get_entities_overlapping_hitbox(std::vector<ENT_TYPE>{entity_type}, mask, hitbox, layer);
+    return get_entities_overlapping_hitbox(EntityTypeSet{entity_type}, mask, hitbox, layer);
 }
 
+std::vector<uint32_t> get_entities_overlapping(const EntityTypeSet& entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, LAYER layer)
+{
+    return get_entities_overlapping_hitbox(entity_types, mask, {sx, sy2, sx2, sy}, layer);
+}
 std::vector<uint32_t> get_entities_overlapping(std::vector<ENT_TYPE> entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, LAYER layer)
 {
-    return get_entities_overlapping_hitbox(std::move(entity_types), mask, {sx, sy2, sx2, sy}, layer);
+    return get_entities_overlapping_hitbox(EntityTypeSet{entity_types}, mask, {sx, sy2, sx2, sy}, layer);
 }
 std::vector<uint32_t> get_entities_overlapping(ENT_TYPE entity_type, uint32_t mask, float sx, float sy, float sx2, float sy2, LAYER layer)
 {
-    return get_entities_overlapping_hitbox(std::vector<ENT_TYPE>{entity_type}, mask, {sx, sy2, sx2, sy}, layer);
+    return get_entities_overlapping_hitbox(EntityTypeSet{entity_type}, mask, {sx, sy2, sx2, sy}, layer);
 }
 
-std::vector<uint32_t> get_entities_overlapping_by_pointer(std::vector<ENT_TYPE> entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer)
+void for_each_entity_overlapping_by_pointer(const EntityTypeSet& entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer, EntityVisitor visitor)
 {
-    std::vector<uint32_t> found;
-    for (auto& item : layer->all_entities)
+    auto visit_entity = [&](Entity* item)
     {
-        if ((mask == 0 || (item->type->search_flags & mask)) && entity_type_check(std::move(entity_types), item->type->id) && item->overlaps_with(sx, sy, sx2, sy2))
+        if ((mask == 0 || (item->type->search_flags & mask)) && entity_types.contains(item->type->id) && item->overlaps_with(sx, sy, sx2, sy2))
         {
-            found.push_back(item->uid);
+            visitor(item);
+        }
+    };
+    if (const EntitySpatialGrid* grid = get_entity_spatial_grid(layer))
+    {
+        const float slack = g_entity_index_slack;
+        grid->for_each_candidate(std::min(sx, sx2) - slack, std::min(sy, sy2) - slack, std::max(sx, sx2) + slack, std::max(sy, sy2) + slack, visit_entity);
+    }
+    else
+    {
+        for (auto& item : layer->all_entities)
+        {
+            visit_entity(item);
         }
     }
+}
+
+std::vector<uint32_t> get_entities_overlapping_by_pointer(const EntityTypeSet& entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer)
+{
+    std::vector<uint32_t> found;
+    for_each_entity_overlapping_by_pointer(entity_types, mask, sx, sy, sx2, sy2, layer, [&found](Entity* item)
+                                           { found.push_back(item->uid); });
     return found;
 }
+std::vector<uint32_t> get_entities_overlapping_by_pointer(std::vector<ENT_TYPE> entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer)
+{
+    return get_entities_overlapping_by_pointer(EntityTypeSet{entity_types}, mask, sx, sy, sx2, sy2, layer);
+}
 std::vector<uint32_t> get_entities_overlapping_by_pointer(ENT_TYPE entity_type, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer)
 {
-    return get_entities_overlapping_by_pointer(std::vector<ENT_TYPE>{entity_type}, mask, sx, sy, sx2, sy2, layer);
+    return get_entities_overlapping_by_pointer(EntityTypeSet{entity_type}, mask, sx, sy, sx2, sy2, layer);
 }
 
 void set_door_target(uint32_t uid, uint8_t w, uint8_t l, uint8_t t)
@@ -678,9 +983,13 @@ void set_contents(uint32_t uid, ENT_TYPE item_entity_type)
     Entity* container = get_entity_ptr(uid);
     if (container == nullptr)
         return;
+    static const ENT_TYPE coffin = to_id("ENT_TYPE_ITEM_COFFIN"_ent_type);
+    static const ENT_TYPE crate = to_id("ENT_TYPE_ITEM_CRATE"_ent_type);
+    static const ENT_TYPE present = to_id("ENT_TYPE_ITEM_PRESENT"_ent_type);
+    static const ENT_TYPE ghist_present = to_id("ENT_TYPE_ITEM_GHIST_PRESENT"_ent_type);
+    static const ENT_TYPE pot = to_id("ENT_TYPE_ITEM_POT"_ent_type);
     uint32_t type = container->type->id;
-    if (type != to_id("ENT_TYPE_ITEM_COFFIN") && type != to_id("ENT_TYPE_ITEM_CRATE") && type != to_id("ENT_TYPE_ITEM_PRESENT") &&
-        type != to_id("ENT_TYPE_ITEM_GHIST_PRESENT") && type != to_id("ENT_TYPE_ITEM_POT"))
+    if (type != coffin && type != crate && type != present && type != ghist_present && type != pot)
         return;
     container->as<Container>()->inside = item_entity_type;
 }
@@ -710,40 +1019,41 @@ bool entity_has_item_uid(uint32_t uid, uint32_t item_uid)
     return false;
 };
 
-bool entity_has_item_type(uint32_t uid, std::vector<ENT_TYPE> entity_types)
+bool entity_has_item_type(uint32_t uid, const EntityTypeSet& entity_types)
 {
     Entity* entity = get_entity_ptr(uid);
     if (entity == nullptr)
         return false;
     if (entity->items.count > 0)
     {
-        const std::vector<ENT_TYPE> proper_types = get_proper_types(std::move(entity_types));
         int* pitems = (int*)entity->items.begin;
         for (unsigned int i = 0; i < entity->items.count; i++)
         {
             Entity* item = get_entity_ptr(pitems[i]);
             if (item == nullptr)
                 continue;
-            if (entity_type_check(proper_types, item->type->id))
+            if (entity_types.contains(item->type->id))
                 return true;
         }
     }
     return false;
 }
+bool entity_has_item_type(uint32_t uid, std::vector<ENT_TYPE> entity_types)
+{
+    return entity_has_item_type(uid, EntityTypeSet{entity_types});
+}
 bool entity_has_item_type(uint32_t uid, ENT_TYPE entity_type)
 {
-    return entity_has_item_type(uid, std::vector<ENT_TYPE>{entity_type});
+    return entity_has_item_type(uid, EntityTypeSet{entity_type});
 }
 
-std::vector<uint32_t> entity_get_items_by(uint32_t uid, std::vector<ENT_TYPE> entity_types, uint32_t mask)
+void for_each_entity_item_by(uint32_t uid, const EntityTypeSet& entity_types, uint32_t mask, EntityVisitor visitor)
 {
-    std::vector<uint32_t> found;
     Entity* entity = get_entity_ptr(uid);
     if (entity == nullptr)
-        return found;
+        return;
     if (entity->items.count > 0)
     {
-        const std::vector<ENT_TYPE> proper_types = get_proper_types(std::move(entity_types));
         uint32_t* pitems = entity->items.begin;
         for (unsigned int i = 0; i < entity->items.count; i++)
         {
@@ -752,33 +1062,47 @@ std::vector<uint32_t> entity_get_items_by(uint32_t uid, std::vector<ENT_TYPE> en
             {
                 continue;
             }
-            if ((mask == 0 || (item->type->search_flags & mask)) && entity_type_check(proper_types, item->type->id))
+            if ((mask == 0 || (item->type->search_flags & mask)) && entity_types.contains(item->type->id))
             {
-                found.push_back(item->uid);
+                visitor(item);
             }
         }
     }
+}
+
+std::vector<uint32_t> entity_get_items_by(uint32_t uid, const EntityTypeSet& entity_types, uint32_t mask)
+{
+    std::vector<uint32_t> found;
+    for_each_entity_item_by(uid, entity_types, mask, [&found](Entity* item)
+                            { found.push_back(item->uid); });
     return found;
 }
+std::vector<uint32_t> entity_get_items_by(uint32_t uid, std::vector<ENT_TYPE> entity_types, uint32_t mask)
+{
+    return entity_get_items_by(uid, EntityTypeSet{entity_types}, mask);
+}
 std::vector<uint32_t> entity_get_items_by(uint32_t uid, ENT_TYPE entity_type, uint32_t mask)
 {
-    return entity_get_items_by(uid, std::vector<ENT_TYPE>{entity_type}, mask);
+    return entity_get_items_by(uid, EntityTypeSet{entity_type}, mask);
 }
 
 void lock_door_at(float x, float y)
 {
+    static const ENT_TYPE first_door = to_id("ENT_TYPE_FLOOR_DOOR_ENTRANCE"_ent_type);
+    static const ENT_TYPE last_door = to_id("ENT_TYPE_FLOOR_DOOR_EGGPLANT_WORLD"_ent_type);
+    static const ENT_TYPE bg_door = to_id("ENT_TYPE_BG_DOOR"_ent_type);
+    static const ENT_TYPE bg_door_cog = to_id("ENT_TYPE_BG_DOOR_COG"_ent_type);
+    static const ENT_TYPE bg_door_eggplant_world = to_id("ENT_TYPE_BG_DOOR_EGGPLANT_WORLD"_ent_type);
     std::vector<uint32_t> items = get_entities_at({}, 0, x, y, LAYER::FRONT, 1);
     for (auto id : items)
     {
         Entity* door = get_entity_ptr(id);
-        if (door->type->id >= to_id("ENT_TYPE_FLOOR_DOOR_ENTRANCE") && door->type->id <= to_id("ENT_TYPE_FLOOR_DOOR_EGGPLANT_WORLD"))
+        if (door->type->id >= first_door && door->type->id <= last_door)
         {
             door->flags &= ~(1U << 19);
             door->flags |= 1U << 21;
         }
-        else if (
-            door->type->id == to_id("ENT_TYPE_BG_DOOR") || door->type->id == to_id("ENT_TYPE_BG_DOOR_COG") ||
-            door->type->id == to_id("ENT_TYPE_BG_DOOR_EGGPLANT_WORLD"))
+        else if (door->type->id == bg_door || door->type->id == bg_door_cog || door->type->id == bg_door_eggplant_world)
         {
             door->animation_frame &= ~1U;
         }
@@ -787,18 +1111,21 @@ void lock_door_at(float x, float y)
 
 void unlock_door_at(float x, float y)
 {
+    static const ENT_TYPE first_door = to_id("ENT_TYPE_FLOOR_DOOR_ENTRANCE"_ent_type);
+    static const ENT_TYPE last_door = to_id("ENT_TYPE_FLOOR_DOOR_EGGPLANT_WORLD"_ent_type);
+    static const ENT_TYPE bg_door = to_id("ENT_TYPE_BG_DOOR"_ent_type);
+    static const ENT_TYPE bg_door_cog = to_id("ENT_TYPE_BG_DOOR_COG"_ent_type);
+    static const ENT_TYPE bg_door_eggplant_world = to_id("ENT_TYPE_BG_DOOR_EGGPLANT_WORLD"_ent_type);
     std::vector<uint32_t> items = get_entities_at({}, 0, x, y, LAYER::FRONT, 1);
     for (auto id : items)
     {
         Entity* door = get_entity_ptr(id);
-        if (door->type->id >= to_id("ENT_TYPE_FLOOR_DOOR_ENTRANCE") && door->type->id <= to_id("ENT_TYPE_FLOOR_DOOR_EGGPLANT_WORLD"))
+        if (door->type->id >= first_door && door->type->id <= last_door)
         {
             door->flags |= 1U << 19;
             door->flags &= ~(1U << 21);
         }
-        else if (
-            door->type->id == to_id("ENT_TYPE_BG_DOOR") || door->type->id == to_id("ENT_TYPE_BG_DOOR_COG") ||
-            door->type->id == to_id("ENT_TYPE_BG_DOOR_EGGPLANT_WORLD"))
+        else if (door->type->id == bg_door || door->type->id == bg_door_cog || door->type->id == bg_door_eggplant_world)
         {
             door->animation_frame |= 1U;
         }
@@ -824,14 +1151,20 @@ void kill_entity(uint32_t uid, std::optional<bool> destroy_corpse)
 {
     Entity* ent = get_entity_ptr(uid);
     if (ent != nullptr)
+    {
         ent->kill(destroy_corpse.value_or(true), nullptr);
+        invalidate_entity_index();
+    }
 }
 
 void destroy_entity(uint32_t uid)
 {
     Entity* ent = get_entity_ptr(uid);
     if (ent != nullptr)
+    {
         ent->destroy();
+        invalidate_entity_index();
+    }
 }
 
 void apply_entity_db(uint32_t uid)
@@ -1209,6 +1542,71 @@ bool is_inside_shop_zone(float x, float y, LAYER layer)
     return false;
 }
 
+// Resolves every drop and drop chance the first time one of them is used, patterns searched in the whole executable are
+// found in a single pass and the ones in virtual functions only scan a few bytes each
+// Entries that can't be resolved here stay 0 and go through the regular search (and its error reporting) on use
+void preload_drop_offsets()
+{
+    static bool preloaded = false;
+    if (preloaded)
+    {
+        return;
+    }
+    preloaded = true;
+
+    auto memory = Memory::get();
+    const char* exe = memory.exe();
+    const size_t code_end = code_section_end(exe);
+
+    MultiPatternScanner exe_patterns;
+    std::vector<size_t> exe_pattern_indices(drop_entries.size());
+    for (size_t i = 0; i < drop_entries.size(); ++i)
+    {
+        if (drop_entries[i].vtable_offset == VTABLE_OFFSET::NONE)
+        {
+            exe_pattern_indices[i] = exe_patterns.add(drop_entries[i].pattern);
+        }
+    }
+    const auto exe_hits = exe_patterns.find_all(exe, memory.after_bundle, code_end);
+
+    // Same steps as replace_drop: skip identical patterns, then collect the following occurrences
+    for (size_t i = 0; i < drop_entries.size(); ++i)
+    {
+        auto& entry = drop_entries[i];
+        const PatternScanner pattern{entry.pattern};
+        std::optional<size_t> hit = entry.vtable_offset == VTABLE_OFFSET::NONE
+                                        ? exe_hits[exe_pattern_indices[i]]
+                                        : pattern.find(exe, get_virtual_function_address(entry.vtable_offset, entry.vtable_rel_offset), code_end);
+        for (auto n_skips = entry.skip; hit.has_value() && n_skips > 0; --n_skips)
+        {
+            hit = pattern.find(exe, hit.value() + entry.value_offset + 1, code_end);
+        }
+
+        size_t offsets[3] = {0};
+        for (auto x = 0; x < entry.vtable_occurrence && hit.has_value(); ++x)
+        {
+            offsets[x] = memory.at_exe(hit.value() + entry.value_offset);
+            if (x + 1 < entry.vtable_occurrence)
+            {
+                hit = pattern.find(exe, hit.value() + entry.value_offset + 1, code_end);
+            }
+        }
+        if (hit.has_value())
+        {
+            std::copy(std::begin(offsets), std::end(offsets), std::begin(entry.offsets));
+        }
+    }
+
+    for (auto& entry : dropchance_entries)
+    {
+        const size_t vfunc_address = get_virtual_function_address(entry.vtable_offset, entry.vtable_rel_offset);
+        if (auto hit = PatternScanner{entry.pattern}.find(exe, vfunc_address, code_end))
+        {
+            entry.offset = memory.at_exe(hit.value());
+        }
+    }
+}
+
 void set_drop_chance(int32_t dropchance_id, uint32_t new_drop_chance)
 {
     if (dropchance_id < (int32_t)dropchance_entries.size())
@@ -1219,6 +1617,7 @@ void set_drop_chance(int32_t dropchance_id, uint32_t new_drop_chance)
                 recover_mem("drop_chance");
             return;
         }
+        preload_drop_offsets();
         auto& entry = dropchance_entries.at(dropchance_id);
         if (entry.offset == 0)
         {
@@ -1265,6 +1664,7 @@ void replace_drop(int32_t drop_id, ENT_TYPE new_drop_entity_type)
 
             return;
         }
+        preload_drop_offsets();
         if (entry.offsets[0] == 0)
         {
             auto memory = Memory::get();
@@ -1,13 +1,39 @@
 #pragma once
 
 #include "entities_chars.hpp"
+#include "entity_type_set.hpp"
 #include "screen.hpp"
 #include "state.hpp"
 
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+// Non-owning reference to a callable taking an Entity*, lets the for_each_entity_* functions take lambdas without
+// allocating, the callable has to outlive the call it is passed to
+class EntityVisitor
+{
+  public:
+    template <class FunT>
+    requires(!std::is_same_v<std::decay_t<FunT>, EntityVisitor>) EntityVisitor(FunT&& fun)
+        : object{const_cast<void*>(static_cast<const void*>(std::addressof(fun)))}, call{[](void* obj, Entity* entity)
+                                                                                         { (*static_cast<std::remove_reference_t<FunT>*>(obj))(entity); }}
+    {
+    }
+
+    void operator()(Entity* entity) const
+    {
+        call(object, entity);
+    }
+
+  private:
+    void* object;
+    void (*call)(void*, Entity*);
+};
+
 void teleport(float x, float y, bool s, float vx, float vy, bool snap);
 void godmode(bool g);
 void godmode_companions(bool g);
@@ -42,18 +68,59 @@ float screen_distance(float x);
 float get_zoom_level();
 std::vector<uint32_t> filter_entities(std::vector<uint32_t> entities, std::function<bool(Entity*)> predicate);
 std::vector<uint32_t> get_entities();
+void for_each_entity_by(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer, EntityVisitor visitor);
+std::vector<uint32_t> get_entities_by(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer);
+// Results of get_entities_by, get_entities_at and get_entities_overlapping_hitbox within one frame, every script that
+// enables the cache has its own, so one script doesn't change how fresh the queries of other scripts are
+struct EntityQueryCache;
+std::shared_ptr<EntityQueryCache> make_entity_query_cache();
+void set_entity_query_cache_enabled(EntityQueryCache& cache, bool enabled);
+// Queries on this thread use cache until this is called again, nullptr runs them uncached, returns the previous cache
+EntityQueryCache* set_active_entity_query_cache(EntityQueryCache* cache);
+// Runs queries on this thread uncached again if cache is the active one, for when its owner goes away
+void release_entity_query_cache(const EntityQueryCache* cache);
+// Makes the cache of a script the active one while the script runs and restores the previous one afterwards, the cache
+// is kept alive for as long as it is active
+class EntityQueryCacheScope
+{
+  public:
+    explicit EntityQueryCacheScope(std::shared_ptr<EntityQueryCache> cache)
+        : m_Cache{std::move(cache)}, m_Previous{set_active_entity_query_cache(m_Cache.get())}
+    {
+    }
+    ~EntityQueryCacheScope()
+    {
+        set_active_entity_query_cache(m_Previous);
+    }
+    EntityQueryCacheScope(const EntityQueryCacheScope&) = delete;
+    EntityQueryCacheScope& operator=(const EntityQueryCacheScope&) = delete;
+
+  private:
+    std::shared_ptr<EntityQueryCache> m_Cache;
+    EntityQueryCache* m_Previous;
+};
 std::vector<uint32_t> get_entities_by(std::vector<ENT_TYPE> entity_types, uint32_t mask, LAYER layer);
 std::vector<uint32_t> get_entities_by(ENT_TYPE entity_type, uint32_t mask, LAYER layer);
+void get_entity_properties_by(const EntityTypeSet& entity_types, uint32_t mask, LAYER layer, bool use_render_pos, EntityProperties& out);
 std::vector<uint32_t> get_entities_by_type(std::vector<ENT_TYPE> entity_types);
 std::vector<uint32_t> get_entities_by_type(ENT_TYPE entity_type);
 std::vector<uint32_t> get_entities_by_mask(uint32_t mask);
 std::vector<uint32_t> get_entities_by_layer(LAYER layer);
+void for_each_entity_at(const EntityTypeSet& entity_types, uint32_t mask, float x, float y, LAYER layer, float radius, EntityVisitor visitor);
+std::vector<uint32_t> get_entities_at(const EntityTypeSet& entity_types, uint32_t mask, float x, float y, LAYER layer, float radius);
 std::vector<uint32_t> get_entities_at(std::vector<ENT_TYPE> entity_types, uint32_t mask, float x, float y, LAYER layer, float radius);
+// Returns up to count uids of the entities closest to (x, y) that are less than max_radius away, closest first
+std::vector<uint32_t> get_nearest_entities(float x, float y, LAYER layer, const EntityTypeSet& entity_types, uint32_t mask, uint32_t count, float max_radius);
 std::vector<uint32_t> get_entities_at(ENT_TYPE entity_type, uint32_t mask, float x, float y, LAYER layer, float radius);
+void for_each_entity_overlapping_hitbox(const EntityTypeSet& entity_types, uint32_t mask, AABB hitbox, LAYER layer, EntityVisitor visitor);
+std::vector<uint32_t> get_entities_overlapping_hitbox(const EntityTypeSet& entity_types, uint32_t mask, AABB hitbox, LAYER layer);
 std::vector<uint32_t> get_entities_overlapping_hitbox(std::vector<ENT_TYPE> entity_types, uint32_t mask, AABB hitbox, LAYER layer);
 std::vector<uint32_t> get_entities_overlapping_hitbox(ENT_TYPE entity_type, uint32_t mask, AABB hitbox, LAYER layer);
+std::vector<uint32_t> get_entities_overlapping(const EntityTypeSet& entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, LAYER layer);
 std::vector<uint32_t> get_entities_overlapping(std::vector<ENT_TYPE> entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, LAYER layer);
 std::vector<uint32_t> get_entities_overlapping(ENT_TYPE entity_type, uint32_t mask, float sx, float sy, float sx2, float sy2, LAYER layer);
+void for_each_entity_overlapping_by_pointer(const EntityTypeSet& entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer, EntityVisitor visitor);
+std::vector<uint32_t> get_entities_overlapping_by_pointer(const EntityTypeSet& entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer);
 std::vector<uint32_t> get_entities_overlapping_by_pointer(std::vector<ENT_TYPE> entity_types, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer);
 std::vector<uint32_t> get_entities_overlapping_by_pointer(ENT_TYPE entity_type, uint32_t mask, float sx, float sy, float sx2, float sy2, Layer* layer);
 void set_door_target(uint32_t uid, uint8_t w, uint8_t l, uint8_t t);
@@ -61,8 +128,11 @@ std::tuple<uint8_t, uint8_t, uint8_t> get_door_target(uint32_t uid);
 void set_contents(uint32_t uid, ENT_TYPE item_entity_type);
 void entity_remove_item(uint32_t id, uint32_t item_uid);
 bool entity_has_item_uid(uint32_t uid, uint32_t item_uid);
+bool entity_has_item_type(uint32_t uid, const EntityTypeSet& entity_types);
 bool entity_has_item_type(uint32_t uid, std::vector<ENT_TYPE> entity_types);
 bool entity_has_item_type(uint32_t uid, ENT_TYPE entity_type);
+void for_each_entity_item_by(uint32_t uid, const EntityTypeSet& entity_types, uint32_t mask, EntityVisitor visitor);
+std::vector<uint32_t> entity_get_items_by(uint32_t uid, const EntityTypeSet& entity_types, uint32_t mask);
 std::vector<uint32_t> entity_get_items_by(uint32_t uid, std::vector<ENT_TYPE> entity_types, uint32_t mask);
 std::vector<uint32_t> entity_get_items_by(uint32_t uid, ENT_TYPE entity_type, uint32_t mask);
 void lock_door_at(float x, float y);
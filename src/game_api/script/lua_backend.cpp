@@ -24,6 +24,57 @@
 
 #include <sol/sol.hpp>
 
+void ScreenCallbacks::add(int id, ScreenCallback callback)
+{
+    if (auto* callbacks = bucket(callback.screen))
+    {
+        callbacks->push_back({id, std::move(callback)});
+    }
+}
+bool ScreenCallbacks::mark_cleared(int id)
+{
+    for (auto& callbacks : buckets)
+    {
+        for (auto& [callback_id, callback] : callbacks)
+        {
+            if (callback_id == id)
+            {
+                callback.cleared = true;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+void ScreenCallbacks::erase_cleared()
+{
+    for (auto& callbacks : buckets)
+    {
+        std::erase_if(callbacks, [](auto& callback)
+                      { return callback.second.cleared; });
+    }
+}
+void ScreenCallbacks::clear()
+{
+    for (auto& callbacks : buckets)
+    {
+        callbacks.clear();
+    }
+}
+ScreenCallbacks::Bucket* ScreenCallbacks::bucket(ON screen)
+{
+    const size_t value = static_cast<size_t>(screen);
+    if (value < num_game_screens)
+    {
+        return &buckets[value];
+    }
+    if (value >= static_cast<size_t>(ON::GUIFRAME) && value <= static_cast<size_t>(ON::TOAST))
+    {
+        return &buckets[num_game_screens + value - static_cast<size_t>(ON::GUIFRAME)];
+    }
+    return nullptr;
+}
+
 std::recursive_mutex g_all_backends_mutex;
 std::vector<LuaBackend*> g_all_backends;
 
@@ -68,6 +119,7 @@ LuaBackend::~LuaBackend()
     }
 
     clear_all_callbacks();
+    release_entity_query_cache(entity_query_cache.get());
 }
 
 void LuaBackend::clear()
@@ -122,6 +174,10 @@ void LuaBackend::clear_all_callbacks()
             ent->unhook(id);
         }
     }
+    for (auto& [entity_type, id] : entity_type_hooks)
+    {
+        clear_entity_type_hook(entity_type, id);
+    }
     for (auto& [screen_id, id] : screen_hooks)
     {
         if (Screen* screen = get_screen_ptr(screen_id))
@@ -136,6 +192,9 @@ void LuaBackend::clear_all_callbacks()
     entity_hooks.clear();
     clear_entity_hooks.clear();
     entity_dtor_hooks.clear();
+    entity_type_hooks.clear();
+    clear_entity_type_hooks.clear();
+    statemachine_batch_callbacks.clear();
     screen_hooks.clear();
     clear_screen_hooks.clear();
     options.clear();
@@ -155,6 +214,8 @@ void LuaBackend::clear_all_callbacks()
 bool LuaBackend::reset()
 {
     clear();
+    // A reloaded script enables the cache again if it still wants it
+    set_entity_query_cache_enabled(*entity_query_cache, false);
     return true;
 }
 
@@ -241,69 +302,108 @@ bool LuaBackend::update()
                 on_win.value()();
         }
 
-        for (auto id : clear_callbacks)
+        // Cleared callbacks were skipped since they were cleared, now they are removed in one pass per container
+        if (!clear_callbacks.empty())
         {
-            level_timers.erase(id);
-            global_timers.erase(id);
-            callbacks.erase(id);
-            load_callbacks.erase(id);
-
-            std::erase_if(pre_tile_code_callbacks, [id](auto& cb)
-                          { return cb.id == id; });
-            std::erase_if(post_tile_code_callbacks, [id](auto& cb)
-                          { return cb.id == id; });
-            std::erase_if(pre_entity_spawn_callbacks, [id](auto& cb)
-                          { return cb.id == id; });
-            std::erase_if(post_entity_spawn_callbacks, [id](auto& cb)
-                          { return cb.id == id; });
+            for (auto id : clear_callbacks)
+            {
+                level_timers.erase(id);
+                global_timers.erase(id);
+                load_callbacks.erase(id);
+            }
+            callbacks.erase_cleared();
+
+            auto is_cleared = [](auto& cb)
+            { return cb.cleared; };
+            std::erase_if(pre_tile_code_callbacks, is_cleared);
+            std::erase_if(post_tile_code_callbacks, is_cleared);
+            std::erase_if(pre_entity_spawn_callbacks, is_cleared);
+            std::erase_if(post_entity_spawn_callbacks, is_cleared);
+            clear_callbacks.clear();
         }
-        clear_callbacks.clear();
 
-        for (auto& [ent_uid, id] : clear_entity_hooks)
+        if (!clear_entity_hooks.empty())
         {
-            auto it = std::find(entity_hooks.begin(), entity_hooks.end(), std::pair{ent_uid, id});
-            if (it != entity_hooks.end())
+            std::unordered_set<int> cleared_entities;
+            std::erase_if(entity_hooks, [this, &cleared_entities](auto& hook)
+                          {
+                              if (!clear_entity_hooks.contains(hook))
+                                  return false;
+                              if (Entity* entity = get_entity_ptr(hook.first))
+                              {
+                                  entity->unhook(hook.second);
+                              }
+                              cleared_entities.insert(hook.first);
+                              return true; });
+
+            // Entities that have no hooks left don't need their dtor hook anymore
+            for (auto& hook : entity_hooks)
             {
-                Entity* entity = get_entity_ptr(ent_uid);
-                if (entity)
-                {
-                    entity->unhook(id);
-                }
-                entity_hooks.erase(it);
+                cleared_entities.erase(hook.first);
+            }
+            std::erase_if(entity_dtor_hooks, [&cleared_entities](auto& dtor_hook)
+                          {
+                              if (!cleared_entities.contains(dtor_hook.first))
+                                  return false;
+                              if (Entity* entity = get_entity_ptr(dtor_hook.first))
+                              {
+                                  entity->unhook(dtor_hook.second);
+                              }
+                              return true; });
+            clear_entity_hooks.clear();
+        }
+        if (!clear_entity_type_hooks.empty())
+        {
+            std::erase_if(entity_type_hooks, [this](auto& hook)
+                          {
+                              if (!clear_entity_type_hooks.contains(hook))
+                                  return false;
+                              clear_entity_type_hook(hook.first, hook.second);
+                              statemachine_batch_callbacks.erase(hook.second);
+                              return true; });
+            clear_entity_type_hooks.clear();
+        }
 
-                const int32_t entity_uid = ent_uid; // Clang doesn't let us reference a local binding in a lambda capture
-                const size_t hooks_left_for_entity = std::count_if(entity_hooks.begin(), entity_hooks.end(), [entity_uid](auto& hook)
-                                                                   { return hook.first == entity_uid; });
-                if (hooks_left_for_entity == 0)
-                {
-                    auto dtor_it = std::find_if(entity_dtor_hooks.begin(), entity_dtor_hooks.end(), [entity_uid](auto& dtor_hook)
-                                                { return dtor_hook.first == entity_uid; });
-                    if (dtor_it != entity_dtor_hooks.end())
-                    {
-                        if (entity)
-                        {
-                            entity->unhook(dtor_it->second);
-                        }
-                        entity_dtor_hooks.erase(dtor_it);
-                    }
-                }
+        // The uids are taken out before any callback runs, a callback may set another batch callback which can rehash the map
+        std::vector<std::pair<std::uint32_t, std::vector<uint32_t>>> pending_batches;
+        for (auto& [id, batch] : statemachine_batch_callbacks)
+        {
+            if (!batch.uids.empty())
+            {
+                pending_batches.emplace_back(id, std::exchange(batch.uids, {}));
             }
         }
-        clear_entity_hooks.clear();
-        for (auto& [screen_id, id] : clear_screen_hooks)
+        for (auto& [id, uids] : pending_batches)
         {
-            auto it = std::find(screen_hooks.begin(), screen_hooks.end(), std::pair{screen_id, id});
-            if (it != screen_hooks.end())
+            // Entities may have been destroyed after their statemachine ran, those are left out
+            sol::table entities = vm->create_table(static_cast<int>(uids.size()), 0);
+            int num_entities = 0;
+            for (uint32_t uid : uids)
             {
-                auto screen = get_screen_ptr(screen_id);
-                if (screen != nullptr)
+                if (Entity* entity = get_entity_ptr(uid))
                 {
-                    screen->unhook(id);
+                    entities[++num_entities] = lua["cast_entity"](entity);
                 }
-                screen_hooks.erase(it);
+            }
+            auto it = statemachine_batch_callbacks.find(id);
+            if (num_entities > 0 && it != statemachine_batch_callbacks.end())
+            {
+                handle_function(it->second.func, entities);
             }
         }
-        clear_screen_hooks.clear();
+        if (!clear_screen_hooks.empty())
+        {
+            std::erase_if(screen_hooks, [this](auto& hook)
+                          {
+                              if (!clear_screen_hooks.contains(hook))
+                                  return false;
+                              if (Screen* screen = get_screen_ptr(hook.first))
+                              {
+                                  screen->unhook(hook.second);
+                              }
+                              return true; });
+            clear_screen_hooks.clear();
+        }
 
         for (auto it = global_timers.begin(); it != global_timers.end();)
         {
@@ -350,95 +450,50 @@ bool LuaBackend::update()
             }
         }
 
-        for (auto& [id, callback] : callbacks)
+        auto run_callbacks = [this, now](ON screen, auto&&... args)
         {
-            if ((ON)g_state->screen == callback.screen && g_state->screen != state.screen && g_state->screen_last != (int)ON::OPTIONS) // game screens
+            for (auto& [id, callback] : callbacks.of(screen))
             {
-                handle_function(callback.func);
+                handle_function(callback.func, args...);
                 callback.lastRan = now;
             }
-            else if (callback.screen == ON::LEVEL && g_state->screen == (int)ON::LEVEL && g_state->screen_last != (int)ON::OPTIONS && state.loading != g_state->loading && g_state->loading == 3)
-            {
-                handle_function(callback.func);
-                callback.lastRan = now;
-            }
-            else if (callback.screen == ON::CAMP && g_state->screen == (int)ON::CAMP && g_state->screen_last != (int)ON::OPTIONS && state.loading != g_state->loading && g_state->loading == 3)
-            {
-                handle_function(callback.func);
-                callback.lastRan = now;
-            }
-            else
-            {
-                switch (callback.screen)
-                {
-                case ON::FRAME:
-                {
-                    if (g_state->time_level != state.time_level && g_state->screen == (int)ON::LEVEL)
-                    {
-                        handle_function(callback.func);
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                case ON::GAMEFRAME:
-                {
-                    if (!g_state->pause && get_frame_count() != state.time_global &&
-                        ((g_state->screen >= (int)ON::CAMP && g_state->screen <= (int)ON::DEATH) || g_state->screen == (int)ON::ARENA_MATCH))
-                    {
-                        handle_function(callback.func);
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                case ON::SCREEN:
-                {
-                    if (g_state->screen != state.screen)
-                    {
-                        handle_function(callback.func);
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                case ON::START:
-                {
-                    if (g_state->screen == (int)ON::LEVEL && g_state->screen_last != (int)ON::OPTIONS && g_state->level_count == 0 && g_state->loading != state.loading && g_state->loading == 3)
-                    {
-                        handle_function(callback.func);
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                case ON::LOADING:
-                {
-                    if (g_state->loading > 0 && g_state->loading != state.loading)
-                    {
-                        handle_function(callback.func);
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                case ON::RESET:
-                {
-                    if ((g_state->quest_flags & 1) > 0 && (g_state->quest_flags & 1) != state.reset)
-                    {
-                        handle_function(callback.func);
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                case ON::SAVE:
-                {
-                    if (g_state->loading != state.loading && g_state->loading == 1)
-                    {
-                        handle_function(callback.func, SaveContext{get_root(), get_name()});
-                        callback.lastRan = now;
-                    }
-                    break;
-                }
-                default:
-                    break;
-                }
-            }
+        };
+
+        // Game screens, ON.LEVEL and ON.CAMP also run when a level finished loading without the screen changing
+        const bool level_loaded = g_state->screen_last != (int)ON::OPTIONS && state.loading != g_state->loading && g_state->loading == 3;
+        if ((g_state->screen != state.screen && g_state->screen_last != (int)ON::OPTIONS) ||
+            ((g_state->screen == (int)ON::LEVEL || g_state->screen == (int)ON::CAMP) && level_loaded))
+        {
+            run_callbacks((ON)g_state->screen);
+        }
+        if (g_state->time_level != state.time_level && g_state->screen == (int)ON::LEVEL)
+        {
+            run_callbacks(ON::FRAME);
+        }
+        if (!g_state->pause && get_frame_count() != state.time_global &&
+            ((g_state->screen >= (int)ON::CAMP && g_state->screen <= (int)ON::DEATH) || g_state->screen == (int)ON::ARENA_MATCH))
+        {
+            run_callbacks(ON::GAMEFRAME);
+        }
+        if (g_state->screen != state.screen)
+        {
+            run_callbacks(ON::SCREEN);
+        }
+        if (g_state->screen == (int)ON::LEVEL && g_state->screen_last != (int)ON::OPTIONS && g_state->level_count == 0 && g_state->loading != state.loading && g_state->loading == 3)
+        {
+            run_callbacks(ON::START);
+        }
+        if (g_state->loading > 0 && g_state->loading != state.loading)
+        {
+            run_callbacks(ON::LOADING);
+        }
+        if ((g_state->quest_flags & 1) > 0 && (g_state->quest_flags & 1) != state.reset)
+        {
+            run_callbacks(ON::RESET);
+        }
+        if (g_state->loading != state.loading && g_state->loading == 1)
+        {
+            run_callbacks(ON::SAVE, SaveContext{get_root(), get_name()});
         }
         int now_l = g_state->time_level;
         for (auto it = level_timers.begin(); it != level_timers.end();)
@@ -522,14 +577,11 @@ void LuaBackend::draw(ImDrawList* dl)
             on_guiframe.value()(draw_ctx);
         }
 
-        for (auto& [id, callback] : callbacks)
+        auto now = get_frame_count();
+        for (auto& [id, callback] : callbacks.of(ON::GUIFRAME))
         {
-            auto now = get_frame_count();
-            if (callback.screen == ON::GUIFRAME)
-            {
-                handle_function(callback.func, draw_ctx);
-                callback.lastRan = now;
-            }
+            handle_function(callback.func, draw_ctx);
+            callback.lastRan = now;
         }
     }
     catch (const sol::error& e)
@@ -607,17 +659,42 @@ void LuaBackend::render_options()
     ImGui::PopID();
 }
 
+void LuaBackend::clear_callback(int32_t callback_id)
+{
+    // Only the first container that has the id can be the right one, they all share cbcount
+    auto mark_cleared = [callback_id](auto& container)
+    {
+        for (auto& cb : container)
+        {
+            if (cb.id == callback_id)
+            {
+                cb.cleared = true;
+                return true;
+            }
+        }
+        return false;
+    };
+    if (!callbacks.mark_cleared(callback_id) && !mark_cleared(pre_tile_code_callbacks) && !mark_cleared(post_tile_code_callbacks) && !mark_cleared(pre_entity_spawn_callbacks))
+    {
+        mark_cleared(post_entity_spawn_callbacks);
+    }
+    clear_callbacks.push_back(callback_id);
+}
 bool LuaBackend::is_callback_cleared(int32_t callback_id)
 {
-    return std::count(clear_callbacks.begin(), clear_callbacks.end(), callback_id);
+    return clear_callbacks.contains(callback_id);
 }
 bool LuaBackend::is_entity_callback_cleared(std::pair<int, uint32_t> callback_id)
 {
-    return std::count(clear_entity_hooks.begin(), clear_entity_hooks.end(), callback_id);
+    return clear_entity_hooks.contains(callback_id);
+}
+bool LuaBackend::is_entity_type_callback_cleared(std::pair<ENT_TYPE, uint32_t> callback_id)
+{
+    return clear_entity_type_hooks.contains(callback_id);
 }
 bool LuaBackend::is_screen_callback_cleared(std::pair<int, uint32_t> callback_id)
 {
-    return std::count(clear_screen_hooks.begin(), clear_screen_hooks.end(), callback_id);
+    return clear_screen_hooks.contains(callback_id);
 }
 
 bool LuaBackend::pre_tile_code(std::string_view tile_code, float x, float y, int layer, uint16_t room_template)
@@ -627,7 +704,7 @@ bool LuaBackend::pre_tile_code(std::string_view tile_code, float x, float y, int
 
     for (auto& callback : pre_tile_code_callbacks)
     {
-        if (is_callback_cleared(callback.id))
+        if (callback.cleared)
             continue;
 
         if (callback.tile_code == tile_code)
@@ -647,7 +724,7 @@ void LuaBackend::post_tile_code(std::string_view tile_code, float x, float y, in
 
     for (auto& callback : post_tile_code_callbacks)
     {
-        if (is_callback_cleared(callback.id))
+        if (callback.cleared)
             continue;
 
         if (callback.tile_code == tile_code)
@@ -665,16 +742,13 @@ void LuaBackend::pre_load_level_files()
     auto now = get_frame_count();
 
     std::lock_guard lock{gil};
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::PRE_LOAD_LEVEL_FILES))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::PRE_LOAD_LEVEL_FILES)
-        {
-            handle_function(callback.func, PreLoadLevelFilesContext{});
-            callback.lastRan = now;
-        }
+        handle_function(callback.func, PreLoadLevelFilesContext{});
+        callback.lastRan = now;
     }
 }
 void LuaBackend::pre_level_generation()
@@ -688,16 +762,13 @@ void LuaBackend::pre_level_generation()
 
     lua["players"] = std::vector<Player*>(get_players());
 
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::PRE_LEVEL_GENERATION))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::PRE_LEVEL_GENERATION)
-        {
-            handle_function(callback.func);
-            callback.lastRan = now;
-        }
+        handle_function(callback.func);
+        callback.lastRan = now;
     }
 }
 void LuaBackend::post_room_generation()
@@ -708,16 +779,13 @@ void LuaBackend::post_room_generation()
     auto now = get_frame_count();
 
     std::lock_guard lock{gil};
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::POST_ROOM_GENERATION))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::POST_ROOM_GENERATION)
-        {
-            handle_function(callback.func, PostRoomGenerationContext{});
-            callback.lastRan = now;
-        }
+        handle_function(callback.func, PostRoomGenerationContext{});
+        callback.lastRan = now;
     }
 }
 void LuaBackend::post_level_generation()
@@ -731,16 +799,13 @@ void LuaBackend::post_level_generation()
 
     lua["players"] = std::vector<Player*>(get_players());
 
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::POST_LEVEL_GENERATION))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::POST_LEVEL_GENERATION)
-        {
-            handle_function(callback.func);
-            callback.lastRan = now;
-        }
+        handle_function(callback.func);
+        callback.lastRan = now;
     }
 }
 
@@ -752,20 +817,17 @@ std::string LuaBackend::pre_get_random_room(int x, int y, uint8_t layer, uint16_
     auto now = get_frame_count();
 
     std::lock_guard lock{gil};
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::PRE_GET_RANDOM_ROOM))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::PRE_GET_RANDOM_ROOM)
-        {
-            callback.lastRan = now;
+        callback.lastRan = now;
 
-            std::string return_value = handle_function_with_return<std::string>(callback.func, x, y, layer, room_template).value_or(std::string{});
-            if (!return_value.empty())
-            {
-                return return_value;
-            }
+        std::string return_value = handle_function_with_return<std::string>(callback.func, x, y, layer, room_template).value_or(std::string{});
+        if (!return_value.empty())
+        {
+            return return_value;
         }
     }
     return std::string{};
@@ -780,18 +842,15 @@ LuaBackend::PreHandleRoomTilesResult LuaBackend::pre_handle_room_tiles(LevelGenR
     PreHandleRoomTilesContext ctx{room_data};
 
     std::lock_guard lock{gil};
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::PRE_HANDLE_ROOM_TILES))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::PRE_HANDLE_ROOM_TILES)
+        callback.lastRan = now;
+        if (handle_function_with_return<bool>(callback.func, x, y, room_template, ctx).value_or(false))
         {
-            callback.lastRan = now;
-            if (handle_function_with_return<bool>(callback.func, x, y, room_template, ctx).value_or(false))
-            {
-                return {true, ctx.modded_room_data};
-            }
+            return {true, ctx.modded_room_data};
         }
     }
     return {false, ctx.modded_room_data};
@@ -804,7 +863,7 @@ Entity* LuaBackend::pre_entity_spawn(std::uint32_t entity_type, float x, float y
 
     for (auto& callback : pre_entity_spawn_callbacks)
     {
-        if (is_callback_cleared(callback.id))
+        if (callback.cleared)
             continue;
 
         bool mask_match = callback.entity_mask == 0 || (get_type(entity_type)->search_flags & callback.entity_mask);
@@ -830,7 +889,7 @@ void LuaBackend::post_entity_spawn(Entity* entity, int spawn_type_flags)
 
     for (auto& callback : post_entity_spawn_callbacks)
     {
-        if (is_callback_cleared(callback.id))
+        if (callback.cleared)
             continue;
 
         bool mask_match = callback.entity_mask == 0 || (entity->type->search_flags & callback.entity_mask);
@@ -853,13 +912,10 @@ void LuaBackend::process_vanilla_render_callbacks(ON event)
 
     auto now = get_frame_count();
     VanillaRenderContext render_ctx;
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(event))
     {
-        if (callback.screen == event)
-        {
-            handle_function(callback.func, render_ctx);
-            callback.lastRan = now;
-        }
+        handle_function(callback.func, render_ctx);
+        callback.lastRan = now;
     }
 }
 
@@ -871,13 +927,10 @@ void LuaBackend::process_vanilla_render_draw_depth_callbacks(ON event, uint8_t d
     auto now = get_frame_count();
     VanillaRenderContext render_ctx;
     render_ctx.bounding_box = bbox;
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(event))
     {
-        if (callback.screen == event)
-        {
-            handle_function(callback.func, render_ctx, draw_depth);
-            callback.lastRan = now;
-        }
+        handle_function(callback.func, render_ctx, draw_depth);
+        callback.lastRan = now;
     }
 }
 
@@ -888,13 +941,10 @@ void LuaBackend::process_vanilla_render_journal_page_callbacks(ON event, Journal
 
     auto now = get_frame_count();
     VanillaRenderContext render_ctx;
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(event))
     {
-        if (callback.screen == event)
-        {
-            handle_function(callback.func, render_ctx, page_type, page);
-            callback.lastRan = now;
-        }
+        handle_function(callback.func, render_ctx, page_type, page);
+        callback.lastRan = now;
     }
 }
 void LuaBackend::hook_entity_dtor(Entity* entity)
@@ -925,17 +975,14 @@ std::u16string LuaBackend::pre_speach_bubble(Entity* entity, char16_t* buffer)
     auto now = get_frame_count();
     std::lock_guard lock{gil};
 
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::SPEECH_BUBBLE))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::SPEECH_BUBBLE)
-        {
-            callback.lastRan = now;
-            std::u16string return_value = handle_function_with_return<std::u16string>(callback.func, lua["cast_entity"](entity), buffer).value_or(std::u16string{no_return_str});
-            return return_value;
-        }
+        callback.lastRan = now;
+        std::u16string return_value = handle_function_with_return<std::u16string>(callback.func, lua["cast_entity"](entity), buffer).value_or(std::u16string{no_return_str});
+        return return_value;
     }
     return std::u16string{no_return_str};
 }
@@ -948,17 +995,14 @@ std::u16string LuaBackend::pre_toast(char16_t* buffer)
     auto now = get_frame_count();
     std::lock_guard lock{gil};
 
-    for (auto& [id, callback] : callbacks)
+    for (auto& [id, callback] : callbacks.of(ON::TOAST))
     {
-        if (is_callback_cleared(id))
+        if (callback.cleared)
             continue;
 
-        if (callback.screen == ON::TOAST)
-        {
-            callback.lastRan = now;
-            std::u16string return_value = handle_function_with_return<std::u16string>(callback.func, buffer).value_or(std::u16string{no_return_str});
-            return return_value;
-        }
+        callback.lastRan = now;
+        std::u16string return_value = handle_function_with_return<std::u16string>(callback.func, buffer).value_or(std::u16string{no_return_str});
+        return return_value;
     }
     return std::u16string{no_return_str};
 }
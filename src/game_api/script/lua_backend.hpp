@@ -5,14 +5,17 @@
 #include "entity.hpp"
 #include "level_api_types.hpp"
 #include "render_api.hpp"
+#include "rpc.hpp"
 #include "screen.hpp"
 #include "script.hpp"
 #include "window_api.hpp"
 
 #include <algorithm>
+#include <array>
 #include <deque>
 #include <filesystem>
 #include <functional>
+#include <iterator>
 #include <mutex>
 #include <string>
 #include <string_view>
@@ -135,6 +138,72 @@ struct ScreenCallback
     sol::function func;
     ON screen;
     int lastRan;
+    // Set by clear_callback, the callback is skipped until update removes it
+    bool cleared{false};
+};
+
+// Callbacks from set_callback grouped by their event, so dispatching an event only visits its own callbacks
+// Callbacks of an event are kept in the order they were set, callbacks for unknown events are dropped since nothing
+// would ever call them
+class ScreenCallbacks
+{
+  public:
+    // A deque so callbacks don't move when a callback sets another one while its event is dispatched
+    using Bucket = std::deque<std::pair<int, ScreenCallback>>;
+
+    // Walks a bucket by index, callbacks that are set during the loop are appended and visited by it too
+    struct Iterator
+    {
+        Bucket* bucket;
+        size_t index;
+
+        std::pair<int, ScreenCallback>& operator*() const
+        {
+            return (*bucket)[index];
+        }
+        Iterator& operator++()
+        {
+            ++index;
+            return *this;
+        }
+        bool operator!=(std::default_sentinel_t) const
+        {
+            return bucket != nullptr && index < bucket->size();
+        }
+    };
+    struct Range
+    {
+        Bucket* bucket;
+
+        Iterator begin() const
+        {
+            return {bucket, 0};
+        }
+        std::default_sentinel_t end() const
+        {
+            return {};
+        }
+    };
+
+    void add(int id, ScreenCallback callback);
+    // Marks the callback as cleared, returns false if there is none with that id
+    bool mark_cleared(int id);
+    // Removes all cleared callbacks
+    void erase_cleared();
+    void clear();
+
+    Range of(ON screen)
+    {
+        return {bucket(screen)};
+    }
+
+  private:
+    static constexpr size_t num_game_screens = static_cast<size_t>(ON::ONLINE_LOBBY) + 1;
+    static constexpr size_t num_custom_events = static_cast<size_t>(ON::TOAST) - static_cast<size_t>(ON::GUIFRAME) + 1;
+
+    Bucket* bucket(ON screen);
+
+    std::array<Bucket, num_game_screens + num_custom_events> buckets;
 };
 
 struct LevelGenCallback
@@ -142,6 +211,7 @@ struct LevelGenCallback
     int id;
     std::string tile_code;
     sol::function func;
+    bool cleared{false};
 };
 
 struct EntitySpawnCallback
@@ -151,6 +221,69 @@ struct EntitySpawnCallback
     std::vector<uint32_t> entity_types;
     SPAWN_TYPE spawn_type_flags;
     sol::function func;
+    bool cleared{false};
+};
+
+struct CallbackIdHash
+{
+    size_t operator()(int32_t id) const
+    {
+        return std::hash<int32_t>{}(id);
+    }
+    template <class FirstT>
+    size_t operator()(const std::pair<FirstT, std::uint32_t>& id) const
+    {
+        return std::hash<std::uint64_t>{}((static_cast<std::uint64_t>(static_cast<std::uint32_t>(id.first)) << 32) | id.second);
+    }
+};
+
+// Ids of the callbacks that were cleared since the last update, in the order they were cleared
+// Callbacks stay hooked until update removes them, until then every call checks contains(), which is a hash lookup
+template <class IdT>
+class ClearedCallbacks
+{
+  public:
+    void push_back(IdT id)
+    {
+        if (lookup.insert(id).second)
+        {
+            ids.push_back(id);
+        }
+    }
+    bool contains(const IdT& id) const
+    {
+        return !ids.empty() && lookup.contains(id);
+    }
+    bool empty() const
+    {
+        return ids.empty();
+    }
+    void clear()
+    {
+        ids.clear();
+        lookup.clear();
+    }
+
+    auto begin() const
+    {
+        return ids.begin();
+    }
+    auto end() const
+    {
+        return ids.end();
+    }
+
+  private:
+    std::vector<IdT> ids;
+    std::unordered_set<IdT, CallbackIdHash> lookup;
+};
+
+// Uids of the entities of a type that ran their statemachine since the last update, passed to func in one call
+struct StatemachineBatchCallback
+{
+    ENT_TYPE entity_type;
+    sol::function func;
+    std::vector<uint32_t> uids;
 };
 
 using TimerCallback = std::variant<IntervalCallback, TimeoutCallback>; // NoAlias
@@ -191,7 +324,7 @@ class LuaBackend
     std::deque<ScriptMessage> messages;
     std::unordered_map<int, TimerCallback> level_timers;
     std::unordered_map<int, TimerCallback> global_timers;
-    std::unordered_map<int, ScreenCallback> callbacks;
+    ScreenCallbacks callbacks;
     std::unordered_map<int, ScreenCallback> load_callbacks;
     std::vector<std::uint32_t> vanilla_sound_callbacks;
     std::vector<LevelGenCallback> pre_tile_code_callbacks;
@@ -200,12 +333,19 @@ class LuaBackend
     std::vector<EntitySpawnCallback> post_entity_spawn_callbacks;
     std::vector<std::uint32_t> chance_callbacks;
     std::vector<std::uint32_t> extra_spawn_callbacks;
-    std::vector<int> clear_callbacks;
+    ClearedCallbacks<int> clear_callbacks;
     std::vector<std::pair<int, std::uint32_t>> entity_hooks;
-    std::vector<std::pair<int, std::uint32_t>> clear_entity_hooks;
+    ClearedCallbacks<std::pair<int, std::uint32_t>> clear_entity_hooks;
     std::vector<std::pair<int, std::uint32_t>> entity_dtor_hooks;
+    std::vector<std::pair<ENT_TYPE, std::uint32_t>> entity_type_hooks;
+    ClearedCallbacks<std::pair<ENT_TYPE, std::uint32_t>> clear_entity_type_hooks;
+    std::unordered_map<std::uint32_t, StatemachineBatchCallback> statemachine_batch_callbacks;
+    // Enabled by the script with set_entity_query_cache, active while the script runs
+    std::shared_ptr<EntityQueryCache> entity_query_cache{make_entity_query_cache()};
+    // Scratch memory of fill_entity_properties, kept so its arrays are only allocated once per script
+    EntityProperties entity_properties;
     std::vector<std::pair<int, std::uint32_t>> screen_hooks;
-    std::vector<std::pair<int, std::uint32_t>> clear_screen_hooks;
+    ClearedCallbacks<std::pair<int, std::uint32_t>> clear_screen_hooks;
     std::vector<std::string> required_scripts;
     std::unordered_map<int, ScriptInput*> script_input;
     std::unordered_set<std::string> windows;
@@ -255,8 +395,10 @@ class LuaBackend
     void draw(ImDrawList* dl);
     void render_options();
 
+    void clear_callback(int32_t callback_id);
     bool is_callback_cleared(int32_t callback_id);
     bool is_entity_callback_cleared(std::pair<int, uint32_t> callback_id);
+    bool is_entity_type_callback_cleared(std::pair<ENT_TYPE, uint32_t> callback_id);
     bool is_screen_callback_cleared(std::pair<int, uint32_t> callback_id);
 
     bool pre_tile_code(std::string_view tile_code, float x, float y, int layer, uint16_t room_template);
@@ -301,6 +443,7 @@ bool LuaBackend::handle_function(sol::function func, Args&&... args)
 template <class Ret, class... Args>
 std::optional<Ret> LuaBackend::handle_function_with_return(sol::function func, Args&&... args)
 {
+    EntityQueryCacheScope query_cache_scope{entity_query_cache};
     auto lua_result = func(std::forward<Args>(args)...);
     if (!lua_result.valid())
     {
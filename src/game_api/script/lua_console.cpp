@@ -484,6 +484,7 @@ bool LuaConsole::on_completion(ImGuiInputTextCallbackData* data)
                     std::vector<sol::table> source{};
 
                     {
+                        EntityQueryCacheScope query_cache_scope{entity_query_cache};
                         const auto obj = execute_lua(lua, fmt::format("return {}", to_complete_base));
                         const auto obj_type = obj.get_type();
                         if (obj_type == sol::type::table)
@@ -895,6 +896,7 @@ std::string LuaConsole::execute_raw(std::string code)
 {
     try
     {
+        EntityQueryCacheScope query_cache_scope{entity_query_cache};
         auto ret = execute_lua(lua, code);
         if (ret.get_type() == sol::type::nil || ret.get_type() == sol::type::none)
         {
@@ -31,11 +31,13 @@
 #include "usertypes/entities_mounts_lua.hpp"
 #include "usertypes/entity_casting_lua.hpp"
 #include "usertypes/entity_lua.hpp"
+#include "usertypes/entity_type_set_lua.hpp"
 #include "usertypes/flags_lua.hpp"
 #include "usertypes/gui_lua.hpp"
 #include "usertypes/hitbox_lua.hpp"
 #include "usertypes/level_lua.hpp"
 #include "usertypes/particles_lua.hpp"
+#include "usertypes/pathfinding_lua.hpp"
 #include "usertypes/player_lua.hpp"
 #include "usertypes/prng_lua.hpp"
 #include "usertypes/save_context.hpp"
@@ -44,6 +46,7 @@
 #include "usertypes/sound_lua.hpp"
 #include "usertypes/state_lua.hpp"
 #include "usertypes/texture_lua.hpp"
+#include "usertypes/tile_map_lua.hpp"
 #include "usertypes/vanilla_render_lua.hpp"
 
 #include "lua_libs/lua_libs.hpp"
@@ -62,6 +65,89 @@ void load_unsafe_libraries(sol::state& lua)
     lua.open_libraries(sol::lib::io, sol::lib::os, sol::lib::ffi, sol::lib::debug);
     require_serpent_lua(lua);
 }
+// Entity types passed from Lua can be an ENT_TYPE, a table of them or an EntityTypeSet, the latter is used without a copy
+const EntityTypeSet& to_entity_type_set(const sol::object& entity_types, EntityTypeSet& storage)
+{
+    if (entity_types.is<EntityTypeSet>())
+    {
+        return entity_types.as<const EntityTypeSet&>();
+    }
+    if (entity_types.get_type() == sol::type::table)
+    {
+        storage = EntityTypeSet{entity_types.as<std::vector<ENT_TYPE>>()};
+    }
+    else if (entity_types.get_type() == sol::type::number)
+    {
+        storage = EntityTypeSet{entity_types.as<ENT_TYPE>()};
+    }
+    return storage;
+}
+// Writes the uids visited by query to out[1..n] and clears what is left in out from an earlier call, returns n
+template <class QueryT>
+size_t fill_entity_uids(sol::table& out, QueryT&& query)
+{
+    const size_t old_size = out.size();
+    size_t count = 0;
+    query([&out, &count](Entity* entity)
+          { out.raw_set(++count, entity->uid); });
+    for (size_t i = count + 1; i <= old_size; i++)
+    {
+        out.raw_set(i, sol::lua_nil);
+    }
+    return count;
+}
+// Writes every column of properties to an array of the same name in out, reusing arrays left in out by an earlier call
+size_t fill_entity_property_columns(sol::state& lua, sol::table& out, const EntityProperties& properties)
+{
+    const size_t count = properties.uids.size();
+    auto fill_column = [&](const char* name, auto&& get_value)
+    {
+        sol::object existing = out.raw_get<sol::object>(name);
+        sol::table column;
+        if (existing.get_type() == sol::type::table)
+        {
+            column = existing.as<sol::table>();
+        }
+        else
+        {
+            column = lua.create_table(static_cast<int>(count), 0);
+            out.raw_set(name, column);
+        }
+        const size_t old_size = column.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            column.raw_set(i + 1, get_value(i));
+        }
+        for (size_t i = count + 1; i <= old_size; i++)
+        {
+            column.raw_set(i, sol::lua_nil);
+        }
+    };
+    fill_column("uid", [&](size_t i)
+                { return properties.uids[i]; });
+    fill_column("type", [&](size_t i)
+                { return properties.types[i]; });
+    fill_column("x", [&](size_t i)
+                { return properties.x[i]; });
+    fill_column("y", [&](size_t i)
+                { return properties.y[i]; });
+    fill_column("layer", [&](size_t i)
+                { return properties.layers[i]; });
+    fill_column("vx", [&](size_t i)
+                { return properties.velocity_x[i]; });
+    fill_column("vy", [&](size_t i)
+                { return properties.velocity_y[i]; });
+    fill_column("left", [&](size_t i)
+                { return properties.hitboxes[i].left; });
+    fill_column("bottom", [&](size_t i)
+                { return properties.hitboxes[i].bottom; });
+    fill_column("right", [&](size_t i)
+                { return properties.hitboxes[i].right; });
+    fill_column("top", [&](size_t i)
+                { return properties.hitboxes[i].top; });
+    return count;
+}
+
 void populate_lua_state(sol::state& lua, SoundManager* sound_manager)
 {
     auto infinite_loop = [](lua_State* argst, [[maybe_unused]] lua_Debug* argdb)
@@ -127,6 +213,9 @@ end
     NCharacterState::register_usertypes(lua);
     NEntityFlags::register_usertypes(lua);
     NEntityCasting::register_usertypes(lua);
+    NEntityTypeSet::register_usertypes(lua);
+    NTileMap::register_usertypes(lua);
+    NPathfinding::register_usertypes(lua);
 
     /// A bunch of [game state](#statememory) variables
     /// Example:
@@ -248,14 +337,14 @@ end
         if (luaCb.screen == ON::LOAD)
             backend->load_callbacks[backend->cbcount] = luaCb; // Make sure load always runs before other callbacks
         else
-            backend->callbacks[backend->cbcount] = luaCb;
+            backend->callbacks.add(backend->cbcount, luaCb);
         return backend->cbcount++;
     };
     /// Clear previously added callback `id`
     lua["clear_callback"] = [](CallbackId id)
     {
         LuaBackend* backend = LuaBackend::get_calling_backend();
-        backend->clear_callbacks.push_back(id);
+        backend->clear_callback(id);
     };
 
     /// Table of options set in the UI, added with the [register_option_functions](#register_option_int).
@@ -569,8 +658,9 @@ end
 
     auto get_entities_by = sol::overload(
         static_cast<std::vector<uint32_t> (*)(ENT_TYPE, uint32_t, LAYER)>(::get_entities_by),
-        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, LAYER)>(::get_entities_by));
-    /// Get uids of entities by some conditions. Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types
+        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, LAYER)>(::get_entities_by),
+        static_cast<std::vector<uint32_t> (*)(const EntityTypeSet&, uint32_t, LAYER)>(::get_entities_by));
+    /// Get uids of entities by some conditions. Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types or an `EntityTypeSet`
     lua["get_entities_by"] = get_entities_by;
     /// Get uids of entities matching id. This function is variadic, meaning it accepts any number of id's.
     /// You can even pass a table! Example:
@@ -609,22 +699,112 @@ end
 
     auto get_entities_at = sol::overload(
         static_cast<std::vector<uint32_t> (*)(ENT_TYPE, uint32_t, float, float, LAYER, float)>(::get_entities_at),
-        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, float, float, LAYER, float)>(::get_entities_at));
-    /// Get uids of matching entities inside some radius. Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types
+        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, float, float, LAYER, float)>(::get_entities_at),
+        static_cast<std::vector<uint32_t> (*)(const EntityTypeSet&, uint32_t, float, float, LAYER, float)>(::get_entities_at));
+    /// Get uids of matching entities inside some radius. Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types or an `EntityTypeSet`
     lua["get_entities_at"] = get_entities_at;
+    /// Get uids of the up to `count` matching entities closest to `x`, `y`, ordered by distance, only entities less than `max_radius` away are considered.
+    /// Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types or an `EntityTypeSet`. Much faster than sorting the result of `get_entities_at` when only a few of them are needed
+    lua["get_nearest_entities"] = [](float x, float y, LAYER layer, sol::object entity_types, uint32_t mask, uint32_t count, float max_radius) -> std::vector<uint32_t>
+    {
+        EntityTypeSet storage;
+        return get_nearest_entities(x, y, layer, to_entity_type_set(entity_types, storage), mask, count, max_radius);
+    };
 
     auto get_entities_overlapping = sol::overload(
         static_cast<std::vector<uint32_t> (*)(ENT_TYPE, uint32_t, float, float, float, float, LAYER)>(::get_entities_overlapping),
-        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, float, float, float, float, LAYER)>(::get_entities_overlapping));
+        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, float, float, float, float, LAYER)>(::get_entities_overlapping),
+        static_cast<std::vector<uint32_t> (*)(const EntityTypeSet&, uint32_t, float, float, float, float, LAYER)>(::get_entities_overlapping));
     /// Deprecated
     /// Use `get_entities_overlapping_hitbox` instead
     lua["get_entities_overlapping"] = get_entities_overlapping;
 
     auto get_entities_overlapping_hitbox = sol::overload(
         static_cast<std::vector<uint32_t> (*)(ENT_TYPE, uint32_t, AABB, LAYER)>(::get_entities_overlapping_hitbox),
-        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, AABB, LAYER)>(::get_entities_overlapping_hitbox));
-    /// Get uids of matching entities overlapping with the given hitbox. Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types
+        static_cast<std::vector<uint32_t> (*)(std::vector<ENT_TYPE>, uint32_t, AABB, LAYER)>(::get_entities_overlapping_hitbox),
+        static_cast<std::vector<uint32_t> (*)(const EntityTypeSet&, uint32_t, AABB, LAYER)>(::get_entities_overlapping_hitbox));
+    /// Get uids of matching entities overlapping with the given hitbox. Set `entity_type` or `mask` to `0` to ignore that, can also use table of entity_types or an `EntityTypeSet`
     lua["get_entities_overlapping_hitbox"] = get_entities_overlapping_hitbox;
+    /// Enables a cache that returns the same uids for identical `get_entities_by`, `get_entities_at` and `get_entities_overlapping_hitbox` calls in the same frame.
+    /// The cache is dropped when entities are spawned, destroyed or teleported, but not when they just move, so `get_entities_at` and `get_entities_overlapping_hitbox`
+    /// may miss movement that happened earlier in the same frame. Disabled by default, only affects the queries of the calling script.
+    lua["set_entity_query_cache"] = [](bool enabled)
+    {
+        // The cache of the calling script is already the active one while it runs
+        LuaBackend* backend = LuaBackend::get_calling_backend();
+        set_entity_query_cache_enabled(*backend->entity_query_cache, enabled);
+    };
+    /// Same as `get_entities_by` but writes the uids to `out` instead of creating a new table, entries left over from an earlier call are removed
+    /// Returns the number of uids, reuse the same table every frame to avoid creating garbage
+    lua["fill_entities_by"] = [](sol::table out, sol::object entity_types, uint32_t mask, LAYER layer) -> size_t
+    {
+        EntityTypeSet storage;
+        const EntityTypeSet& types = to_entity_type_set(entity_types, storage);
+        return fill_entity_uids(out, [&](auto visitor)
+                                { for_each_entity_by(types, mask, layer, visitor); });
+    };
+    /// Same as `get_entities_at` but writes the uids to `out` instead of creating a new table, see `fill_entities_by`
+    lua["fill_entities_at"] = [](sol::table out, sol::object entity_types, uint32_t mask, float x, float y, LAYER layer, float radius) -> size_t
+    {
+        EntityTypeSet storage;
+        const EntityTypeSet& types = to_entity_type_set(entity_types, storage);
+        return fill_entity_uids(out, [&](auto visitor)
+                                { for_each_entity_at(types, mask, x, y, layer, radius, visitor); });
+    };
+    /// Same as `get_entities_overlapping_hitbox` but writes the uids to `out` instead of creating a new table, see `fill_entities_by`
+    lua["fill_entities_overlapping_hitbox"] = [](sol::table out, sol::object entity_types, uint32_t mask, AABB hitbox, LAYER layer) -> size_t
+    {
+        EntityTypeSet storage;
+        const EntityTypeSet& types = to_entity_type_set(entity_types, storage);
+        return fill_entity_uids(out, [&](auto visitor)
+                                { for_each_entity_overlapping_hitbox(types, mask, hitbox, layer, visitor); });
+    };
+    /// Iterate over the entities matching the same conditions as `get_entities_by`, without creating a table of uids
+    /// Entities that are destroyed during the loop are skipped
+    /// ```lua
+    /// for uid, ent in entities_by(0, MASK.MONSTER, LAYER.PLAYER) do
+    ///     ent.health = 1
+    /// end
+    /// ```
+    // lua["entities_by"] = [](sol::object entity_types, uint32_t mask, LAYER layer) -> iterator<uint32_t, Entity>
+    /// Same as `entities_by` but with the conditions of `get_entities_at`
+    // lua["entities_at"] = [](sol::object entity_types, uint32_t mask, float x, float y, LAYER layer, float radius) -> iterator<uint32_t, Entity>
+    /// Same as `entities_by` but with the conditions of `get_entities_overlapping_hitbox`
+    // lua["entities_overlapping_hitbox"] = [](sol::object entity_types, uint32_t mask, AABB hitbox, LAYER layer) -> iterator<uint32_t, Entity>
+    lua.script(R"##(
+        -- Uid tables of finished loops are kept for the next loop, a loop that is left with break just drops its table
+        local entity_query_pool = {}
+        local function step_entity_query(uids)
+            while true do
+                local cursor = uids.cursor + 1
+                local uid = uids[cursor]
+                if uid == nil then
+                    entity_query_pool[#entity_query_pool + 1] = uids
+                    return nil
+                end
+                uids.cursor = cursor
+                local ent = get_entity(uid)
+                if ent ~= nil then
+                    return uid, ent
+                end
+            end
+        end
+        local function start_entity_query(fill, ...)
+            local uids = table.remove(entity_query_pool) or {}
+            fill(uids, ...)
+            uids.cursor = 0
+            return step_entity_query, uids
+        end
+        function entities_by(entity_types, mask, layer)
+            return start_entity_query(fill_entities_by, entity_types, mask, layer)
+        end
+        function entities_at(entity_types, mask, x, y, layer, radius)
+            return start_entity_query(fill_entities_at, entity_types, mask, x, y, layer, radius)
+        end
+        function entities_overlapping_hitbox(entity_types, mask, hitbox, layer)
+            return start_entity_query(fill_entities_overlapping_hitbox, entity_types, mask, hitbox, layer)
+        end
+        )##");
     /// Attaches `attachee` to `overlay`, similar to setting `get_entity(attachee).overlay = get_entity(overlay)`.
     /// However this function offsets `attachee` (so you don't have to) and inserts it into `overlay`'s inventory.
     lua["attach_entity"] = attach_entity_by_uid;
@@ -660,6 +840,23 @@ end
     lua["get_render_position"] = get_render_position;
     /// Get velocity `vx, vy` of an entity by uid. Use this, don't use `Entity.velocityx/velocityy` because those are relative to `Entity.overlay`.
     lua["get_velocity"] = get_velocity;
+    /// Get the properties of many entities with one call instead of calling `get_position`, `get_velocity` and `get_hitbox` for each of them
+    /// Fills the arrays `out.uid`, `out.type`, `out.x`, `out.y`, `out.layer`, `out.vx`, `out.vy`, `out.left`, `out.bottom`, `out.right` and `out.top`, entry `i` of every array belongs to `uids[i]`
+    /// Arrays already in `out` are reused and shortened, so keep `out` around between frames. Entities that don't exist get zeros. Returns the number of entries
+    lua["fill_entity_properties"] = [&lua](sol::table out, std::vector<uint32_t> uids, std::optional<bool> use_render_pos) -> size_t
+    {
+        EntityProperties& properties = LuaBackend::get_calling_backend()->entity_properties;
+        get_entity_properties(uids, use_render_pos.value_or(false), properties);
+        return fill_entity_property_columns(lua, out, properties);
+    };
+    /// Same as `fill_entity_properties` but for the entities matching the conditions of `get_entities_by`
+    lua["fill_entity_properties_by"] = [&lua](sol::table out, sol::object entity_types, uint32_t mask, LAYER layer, std::optional<bool> use_render_pos) -> size_t
+    {
+        EntityProperties& properties = LuaBackend::get_calling_backend()->entity_properties;
+        EntityTypeSet storage;
+        get_entity_properties_by(to_entity_type_set(entity_types, storage), mask, layer, use_render_pos.value_or(false), properties);
+        return fill_entity_property_columns(lua, out, properties);
+    };
     /// Remove item by uid from entity
     lua["entity_remove_item"] = entity_remove_item;
     /// Spawns and attaches ball and chain to `uid`, the initial position of the ball is at the entity position plus `off_x`, `off_y`
@@ -673,13 +870,15 @@ end
 
     auto entity_has_item_type = sol::overload(
         static_cast<bool (*)(uint32_t, ENT_TYPE)>(::entity_has_item_type),
-        static_cast<bool (*)(uint32_t, std::vector<ENT_TYPE>)>(::entity_has_item_type));
+        static_cast<bool (*)(uint32_t, std::vector<ENT_TYPE>)>(::entity_has_item_type),
+        static_cast<bool (*)(uint32_t, const EntityTypeSet&)>(::entity_has_item_type));
     /// Check if the entity `uid` has some ENT_TYPE `entity_type` in their inventory, can also use table of entity_types
     lua["entity_has_item_type"] = entity_has_item_type;
 
     auto entity_get_items_by = sol::overload(
         static_cast<std::vector<uint32_t> (*)(uint32_t, ENT_TYPE, uint32_t)>(::entity_get_items_by),
-        static_cast<std::vector<uint32_t> (*)(uint32_t, std::vector<ENT_TYPE>, uint32_t)>(::entity_get_items_by));
+        static_cast<std::vector<uint32_t> (*)(uint32_t, std::vector<ENT_TYPE>, uint32_t)>(::entity_get_items_by),
+        static_cast<std::vector<uint32_t> (*)(uint32_t, const EntityTypeSet&, uint32_t)>(::entity_get_items_by));
     /// Gets uids of entities attached to given entity uid. Use `entity_type` and `mask` to filter, set them to 0 to return all attached entities.
     lua["entity_get_items_by"] = entity_get_items_by;
     /// Kills an entity by uid. `destroy_corpse` defaults to `true`, if you are killing for example a caveman and want the corpse to stay make sure to pass `false`.
@@ -1004,6 +1203,91 @@ end
         }
         return sol::nullopt;
     };
+    /// Clears a callback that is specific to an entity type.
+    lua["clear_entity_type_callback"] = [](ENT_TYPE entity_type, CallbackId cb_id)
+    {
+        LuaBackend* backend = LuaBackend::get_calling_backend();
+        backend->clear_entity_type_hooks.push_back({entity_type, cb_id});
+    };
+    /// Returns unique id for the callback to be used in [clear_entity_type_callback](#clear_entity_type_callback) or `nil` if `entity_type` is not valid.
+    /// Same as [set_pre_statemachine](#set_pre_statemachine) but for all entities of `entity_type`, including the ones that are spawned later.
+    /// Cheaper than calling `set_pre_statemachine` on every single entity, the hook is set once per type instead of once per entity.
+    /// `entity_type` has to be the type of a `Movable` or else the callback will never be called.
+    lua["set_pre_statemachine_for_type"] = [&lua](ENT_TYPE entity_type, sol::function fun) -> sol::optional<CallbackId>
+    {
+        LuaBackend* backend = LuaBackend::get_calling_backend();
+        std::uint32_t id = reserve_entity_type_hook_id();
+        const bool valid = set_pre_statemachine_for_type(
+            entity_type,
+            id,
+            [=, &lua, fun = std::move(fun)](Movable* self)
+            {
+                if (!backend->get_enabled() || backend->is_entity_type_callback_cleared({entity_type, id}))
+                    return false;
+
+                return backend->handle_function_with_return<bool>(fun, lua["cast_entity"](self)).value_or(false);
+            });
+        if (!valid)
+            return sol::nullopt;
+        backend->entity_type_hooks.push_back({entity_type, id});
+        return id;
+    };
+    /// Returns unique id for the callback to be used in [clear_entity_type_callback](#clear_entity_type_callback) or `nil` if `entity_type` is not valid.
+    /// Same as [set_post_statemachine](#set_post_statemachine) but for all entities of `entity_type`, including the ones that are spawned later.
+    /// Cheaper than calling `set_post_statemachine` on every single entity, the hook is set once per type instead of once per entity.
+    /// `entity_type` has to be the type of a `Movable` or else the callback will never be called.
+    lua["set_post_statemachine_for_type"] = [&lua](ENT_TYPE entity_type, sol::function fun) -> sol::optional<CallbackId>
+    {
+        LuaBackend* backend = LuaBackend::get_calling_backend();
+        std::uint32_t id = reserve_entity_type_hook_id();
+        const bool valid = set_post_statemachine_for_type(
+            entity_type,
+            id,
+            [=, &lua, fun = std::move(fun)](Movable* self)
+            {
+                if (!backend->get_enabled() || backend->is_entity_type_callback_cleared({entity_type, id}))
+                    return;
+
+                backend->handle_function(fun, lua["cast_entity"](self));
+            });
+        if (!valid)
+            return sol::nullopt;
+        backend->entity_type_hooks.push_back({entity_type, id});
+        return id;
+    };
+    /// Returns unique id for the callback to be used in [clear_entity_type_callback](#clear_entity_type_callback) or `nil` if `entity_type` is not valid.
+    /// Batched version of [set_post_statemachine_for_type](#set_post_statemachine_for_type), instead of once per entity the callback is called once per frame,
+    /// with an array of all entities of `entity_type` that ran their statemachine in that frame.
+    /// The callback runs together with the other frame callbacks, after the statemachines, so it can't change what the statemachine did this frame.
+    /// The callback signature is `nil post_statemachine_batch(array<Movable> entities)`
+    lua["set_post_statemachine_batch"] = [](ENT_TYPE entity_type, sol::function fun) -> sol::optional<CallbackId>
+    {
+        LuaBackend* backend = LuaBackend::get_calling_backend();
+        std::uint32_t id = reserve_entity_type_hook_id();
+        // Entries of an unordered_map don't move, the hook is cleared before the entry is erased
+        std::vector<uint32_t>* uids = &backend->statemachine_batch_callbacks[id].uids;
+        const bool valid = set_post_statemachine_for_type(
+            entity_type,
+            id,
+            [=](Movable* self)
+            {
+                if (!backend->get_enabled() || backend->is_entity_type_callback_cleared({entity_type, id}))
+                    return;
+
+                std::lock_guard lock{backend->gil};
+                uids->push_back(self->uid);
+            });
+        if (!valid)
+        {
+            backend->statemachine_batch_callbacks.erase(id);
+            return sol::nullopt;
+        }
+        StatemachineBatchCallback& batch = backend->statemachine_batch_callbacks[id];
+        batch.entity_type = entity_type;
+        batch.func = std::move(fun);
+        backend->entity_type_hooks.push_back({entity_type, id});
+        return id;
+    };
     /// Returns unique id for the callback to be used in [clear_entity_callback](#clear_entity_callback) or `nil` if uid is not valid.
     /// Sets a callback that is called right when an entity is destroyed, e.g. as if by `Entity.destroy()` before the game applies any side effects.
     /// The callback signature is `nil on_destroy(Entity self)`
@@ -65,6 +65,7 @@ ScriptImpl::ScriptImpl(std::string script, std::string file, SoundManager* sound
                 getmeta = false;
             }
         }
+        EntityQueryCacheScope query_cache_scope{entity_query_cache};
         auto lua_result = execute_lua(lua, metacode);
         sol::optional<std::string> meta_name = lua["meta"]["name"];
         sol::optional<std::string> meta_version = lua["meta"]["version"];
@@ -113,6 +114,7 @@ bool ScriptImpl::reset()
     try
     {
         std::lock_guard gil_guard{gil};
+        EntityQueryCacheScope query_cache_scope{entity_query_cache};
         auto lua_result = execute_lua(lua, code);
 
         sol::optional<std::string> meta_name = lua["meta"]["name"];
@@ -168,13 +170,10 @@ void ScriptImpl::set_enabled(bool enbl)
     {
         auto cb_type = enbl ? ON::SCRIPT_ENABLE : ON::SCRIPT_DISABLE;
         auto now = get_frame_count();
-        for (auto& [id, callback] : callbacks)
+        for (auto& [id, callback] : callbacks.of(cb_type))
         {
-            if (callback.screen == cb_type)
-            {
-                handle_function(callback.func);
-                callback.lastRan = now;
-            }
+            handle_function(callback.func);
+            callback.lastRan = now;
         }
     }
     enabled = enbl;
@@ -1,6 +1,7 @@
 #include "entity_lua.hpp"
 #include "custom_types.hpp"
 #include "entity.hpp"
+#include "entity_index.hpp"
 #include "movable.hpp"
 
 #include <sol/sol.hpp>
@@ -138,6 +139,21 @@ void register_usertypes(sol::state& lua)
         return entity.overlay = overlay;
     };
     auto overlay = sol::property(get_overlay, set_overlay);
+    // Moving entities from a script has to rebuild the entity index, queries later in the same frame would miss them otherwise
+    auto x = sol::property([](Entity& entity)
+                           { return entity.x; },
+                           [](Entity& entity, float new_x)
+                           {
+                               entity.x = new_x;
+                               invalidate_entity_index();
+                           });
+    auto y = sol::property([](Entity& entity)
+                           { return entity.y; },
+                           [](Entity& entity, float new_y)
+                           {
+                               entity.y = new_y;
+                               invalidate_entity_index();
+                           });
     auto topmost = [&lua](Entity& entity)
     {
         return lua["cast_entity"](entity.topmost());
@@ -167,9 +183,9 @@ void register_usertypes(sol::state& lua)
         "draw_depth",
         &Entity::draw_depth,
         "x",
-        &Entity::x,
+        std::move(x),
         "y",
-        &Entity::y,
+        std::move(y),
         "layer",
         &Entity::layer,
         "width",
@@ -0,0 +1,30 @@
+#include "entity_type_set_lua.hpp"
+
+#include "entity_type_set.hpp"
+
+#include <sol/sol.hpp>
+
+namespace NEntityTypeSet
+{
+void register_usertypes(sol::state& lua)
+{
+    /// A prebuilt entity type filter, can be passed to every function that takes a table of entity types, e.g. `get_entities_by` or `entity_get_items_by`
+    /// Build it once when the script loads instead of passing a new table every frame, checking an entity against it does not depend on the number of types in it
+    /// Like the tables, a set that is empty or built from `0` matches every type and `CUSTOM_TYPE`s are expanded to the types they stand for
+    /// ```lua
+    /// local monsters = EntityTypeSet.new({ENT_TYPE.MONS_SNAKE, ENT_TYPE.MONS_BAT, CUSTOM_TYPE.ALIEN})
+    /// set_callback(function()
+    ///     local uids = get_entities_by(monsters, MASK.ANY, LAYER.PLAYER)
+    /// end, ON.FRAME)
+    /// ```
+    lua.new_usertype<EntityTypeSet>(
+        "EntityTypeSet",
+        sol::constructors<EntityTypeSet(), EntityTypeSet(ENT_TYPE), EntityTypeSet(std::vector<ENT_TYPE>)>{},
+        "contains",
+        &EntityTypeSet::contains,
+        "matches_all",
+        &EntityTypeSet::matches_all,
+        "add",
+        &EntityTypeSet::add);
+}
+} // namespace NEntityTypeSet
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <sol/forward.hpp>
+
+namespace NEntityTypeSet
+{
+void register_usertypes(sol::state& lua);
+};
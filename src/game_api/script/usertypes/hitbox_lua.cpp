@@ -1,6 +1,7 @@
 #include "hitbox_lua.hpp"
 
 #include "entity.hpp"
+#include "grid_raycast.hpp"
 #include "rpc.hpp"
 
 #include <sol/sol.hpp>
@@ -78,5 +79,26 @@ void register_usertypes(sol::state& lua)
         &AABB::width,
         "height",
         &AABB::height);
+
+    /// Steps through the tiles from `x1`, `y1` to `x2`, `y2` and returns the first grid entity (floors, activefloors etc.) that has any of the `mask` flags, set `mask` to `0` to hit any grid entity.
+    /// Much faster than calling `get_grid_entity_at` for every tile, e.g. for line-of-sight checks
+    lua["raycast_grid"] = static_cast<RaycastHit (*)(float, float, float, float, LAYER, uint32_t)>(raycast_grid);
+    /// Same as `raycast_grid` for many rays at once, `rays` holds `x1, y1, x2, y2` of one ray after the other. Returns one `RaycastHit` per ray
+    lua["raycast_grid_many"] = [](std::vector<float> rays, LAYER layer, uint32_t mask) -> std::vector<RaycastHit>
+    {
+        return raycast_grid_many(rays, layer, mask);
+    };
+
+    /// Result of `raycast_grid`
+    lua.new_usertype<RaycastHit>(
+        "RaycastHit",
+        "uid",
+        sol::readonly(&RaycastHit::uid),
+        "x",
+        sol::readonly(&RaycastHit::x),
+        "y",
+        sol::readonly(&RaycastHit::y),
+        "distance",
+        sol::readonly(&RaycastHit::distance));
 }
 } // namespace NHitbox
@@ -0,0 +1,32 @@
+#include "pathfinding_lua.hpp"
+
+#include "pathfinding.hpp"
+
+#include <sol/sol.hpp>
+
+namespace NPathfinding
+{
+void register_usertypes(sol::state& lua)
+{
+    /// Find the shortest path between the tiles at `x1`, `y1` and `x2`, `y2`, returns the tile coordinates of the path as `{x1, y1, x, y, ..., x2, y2}` or an empty table if there is none.
+    /// Tiles are open unless their grid entity is solid. Without `walking` every open tile can be reached from its 4 neighbours, with `walking` only tiles that are climbable
+    /// or stand on a solid floor or platform allow walking sideways, jumping one tile up or onto a ledge diagonally, from every tile one can fall down.
+    /// Paths are cached until a tile of the layer changes. Tiles are read again every frame and whenever a script spawns, destroys or removes an entity,
+    /// only changing the `flags` of a floor from a script is not seen before the next frame
+    lua["find_path"] = [](float x1, float y1, float x2, float y2, LAYER layer, sol::optional<bool> walking) -> std::vector<uint32_t>
+    {
+        return find_path(x1, y1, x2, y2, layer, walking.value_or(false));
+    };
+    /// Get the direction `dx, dy` in tiles of the first move on a shortest path from `x`, `y` to `target_x`, `target_y`, `0, 0` if there is none, see `find_path` for `walking`.
+    /// The distances to the last few targets of every layer are kept and updated as tiles change, so many entities can follow the same target every frame for very little cost
+    lua["get_path_direction"] = [](float x, float y, float target_x, float target_y, LAYER layer, sol::optional<bool> walking) -> std::pair<int32_t, int32_t>
+    {
+        return get_path_direction(x, y, target_x, target_y, layer, walking.value_or(false));
+    };
+    /// Get the number of moves on a shortest path from `x`, `y` to `target_x`, `target_y`, `-1` if there is none, see `get_path_direction`
+    lua["get_path_distance"] = [](float x, float y, float target_x, float target_y, LAYER layer, sol::optional<bool> walking) -> int32_t
+    {
+        return get_path_distance(x, y, target_x, target_y, layer, walking.value_or(false));
+    };
+}
+} // namespace NPathfinding
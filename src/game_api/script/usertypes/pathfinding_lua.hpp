@@ -0,0 +1,8 @@
+#pragma once
+
+#include <sol/forward.hpp>
+
+namespace NPathfinding
+{
+void register_usertypes(sol::state& lua);
+};
@@ -0,0 +1,53 @@
+#include "tile_map_lua.hpp"
+
+#include "tile_map.hpp"
+
+#include <optional>
+
+#include <sol/sol.hpp>
+
+namespace NTileMap
+{
+void register_usertypes(sol::state& lua)
+{
+    /// A copy of the ENT_TYPEs of all grid entities (floors, activefloors etc.) of a layer, taken with a single call instead of one `get_grid_entity_at` per tile
+    /// Keep it around between frames, `update` only looks at the types of tiles whose entity changed and `get_changed` tells which ones those were
+    /// Tiles are numbered `y * TileMapSnapshot.width + x`, `type_of(index)` is the type of that tile
+    /// The accessors don't create tables, so reading the changed tiles every frame costs nothing when nothing changed
+    /// ```lua
+    /// local map = TileMapSnapshot.new()
+    /// set_callback(function()
+    ///     map:update(LAYER.FRONT)
+    ///     for i = 1, map:num_changed() do
+    ///         local index = map:get_changed(i)
+    ///         local x, y = index % TileMapSnapshot.width, index // TileMapSnapshot.width
+    ///         redraw_minimap_tile(x, y, map:type_at(x, y))
+    ///     end
+    /// end, ON.FRAME)
+    /// ```
+    lua.new_usertype<TileMapSnapshot>(
+        "TileMapSnapshot",
+        sol::constructors<TileMapSnapshot()>{},
+        "width",
+        sol::var(TileMapSnapshot::width),
+        "height",
+        sol::var(TileMapSnapshot::height),
+        "update",
+        static_cast<size_t (TileMapSnapshot::*)(LAYER)>(&TileMapSnapshot::update),
+        "type_at",
+        &TileMapSnapshot::type_at,
+        "type_of",
+        &TileMapSnapshot::type_of,
+        "num_changed",
+        &TileMapSnapshot::num_changed,
+        "get_changed",
+        [](const TileMapSnapshot& map, size_t i) -> std::optional<uint32_t>
+        {
+            // 1-based like Lua arrays, nil past the end so it can be iterated until nil too
+            auto changed = map.changed_tiles();
+            if (i == 0 || i > changed.size())
+                return std::nullopt;
+            return changed[i - 1];
+        });
+}
+} // namespace NTileMap
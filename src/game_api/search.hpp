@@ -9,6 +9,9 @@ using namespace std::string_view_literals;
 
 size_t decode_pc(const char* exe, size_t offset, uint8_t opcode_offset = 3, uint8_t opcode_suffix_offset = 0, uint8_t opcode_addr_size = 4);
 size_t decode_imm(const char* exe, size_t offset, uint8_t opcode_offset = 3);
+// Walks back from the address to the first instruction of the function, i.e. the first 16 byte aligned address that
+// follows an int3 padding byte
+size_t function_start(size_t off);
 
 // Find the location of the instruction (needle) with wildcard (* or \x2a) support
 // Optional pattern_name for better error messages
@@ -17,6 +20,8 @@ size_t decode_imm(const char* exe, size_t offset, uint8_t opcode_offset = 3);
 size_t find_inst(const char* exe, std::string_view needle, size_t start, std::optional<size_t> end = std::nullopt, std::string_view pattern_name = ""sv, bool is_required = true);
 
 size_t find_after_bundle(size_t exe);
+// End of the code section, the default end of find_inst
+size_t code_section_end(const char* exe);
 
 void preload_addresses();
 size_t get_address(std::string_view address_name);
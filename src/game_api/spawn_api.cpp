@@ -2,6 +2,7 @@
 
 #include "entities_liquids.hpp"
 #include "entity.hpp"
+#include "entity_index.hpp"
 #include "layer.hpp"
 #include "level_api.hpp"
 #include "logger.h"
@@ -490,7 +491,9 @@ Entity* spawn_entity(EntityFactory* entity_factory, std::uint32_t entity_type, f
         spawned_ent = g_spawn_entity_trampoline(entity_factory, entity_type, x, y, layer, overlay, some_bool);
     }
 
+    apply_entity_type_hooks(spawned_ent);
     post_entity_spawn(spawned_ent, g_SpawnTypeFlags);
+    invalidate_entity_index();
     if (g_temp_entity_spawn_hook)
     {
         g_temp_entity_spawn_hook(spawned_ent);
@@ -1,4 +1,5 @@
 #include "state.hpp"
+#include "entity_index.hpp"
 #include "game_manager.hpp"
 #include "level_api.hpp"
 #include "logger.h"
@@ -73,6 +74,7 @@ State& State::get()
         STATE = State{addr_location};
         STATE.ptr()->level_gen->init();
         init_spawn_hooks();
+        init_entity_index_hooks();
         init_render_api_hooks();
         get_is_init() = true;
         strings_init();
@@ -430,16 +432,26 @@ SaveData* State::savedata()
 }
 
 Entity* State::find(uint32_t uid)
+{
+    size_t slot;
+    return find(uid, slot);
+}
+
+Entity* State::find(uint32_t uid, size_t& slot)
 {
     // Ported from MauveAlert's python code in the CAT tracker
-    auto mask = ptr()->uid_to_entity_mask;
+    // The state is decoded once, every decode reads the heap base of the main thread
+    const StateMemory* state = ptr();
+    auto mask = state->uid_to_entity_mask;
+    const RobinHoodTableEntry* data = state->uid_to_entity_data;
     uint32_t target_uid_plus_one = uid + 1;
-    uint32_t cur_index = target_uid_plus_one & mask;
+    size_t cur_index = target_uid_plus_one & mask;
     while (true)
     {
-        auto entry = ptr()->uid_to_entity_data[cur_index];
+        const auto& entry = data[cur_index];
         if (entry.uid_plus_one == target_uid_plus_one)
         {
+            slot = cur_index;
             return entry.entity;
         }
 
@@ -269,6 +269,8 @@ struct State
     }
 
     Entity* find(uint32_t uid);
+    // Same as find, slot is set to the index of uid in uid_to_entity_data if it was found
+    Entity* find(uint32_t uid, size_t& slot);
 
     std::pair<float, float> get_camera_position();
     void set_camera_position(float cx, float cy);
@@ -0,0 +1,38 @@
+#include "tile_map.hpp"
+
+#include "entity.hpp"
+#include "layer.hpp"
+#include "rpc.hpp"
+#include "state.hpp"
+
+size_t TileMapSnapshot::update(LAYER layer)
+{
+    return update(State::get().layer(enum_to_layer(layer)));
+}
+
+size_t TileMapSnapshot::update(Layer* layer)
+{
+    changed.clear();
+    Entity* const* grid = &layer->grid_entities[0][0];
+    for (uint32_t i = 0; i < width * height; i++)
+    {
+        // Entities that are destroyed may leave their memory to a new entity at the same tile, so the uid is checked too
+        Entity* entity = grid[i];
+        const uint32_t uid = entity != nullptr ? entity->uid : 0;
+        if (synced && entity == tile_entities[i] && uid == tile_uids[i])
+        {
+            continue;
+        }
+
+        const uint16_t type = entity != nullptr ? static_cast<uint16_t>(entity->type->id) : 0;
+        tile_entities[i] = entity;
+        tile_uids[i] = uid;
+        if (!synced || type != tile_types[i])
+        {
+            tile_types[i] = type;
+            changed.push_back(i);
+        }
+    }
+    synced = true;
+    return changed.size();
+}
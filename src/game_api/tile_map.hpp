@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "aliases.hpp"
+
+class Entity;
+struct Layer;
+
+// Copy of the ENT_TYPEs in Layer::grid_entities, 0 for empty tiles
+// update() only looks at the types of tiles whose entity changed since the last update and remembers which tiles those
+// were, so users can re-sync their own data from changed_tiles() instead of the whole grid
+class TileMapSnapshot
+{
+  public:
+    static constexpr uint32_t width = 0x56;
+    static constexpr uint32_t height = 0x7e;
+
+    /// Refreshes the snapshot from the grid of the layer, returns the number of tiles that changed
+    size_t update(LAYER layer);
+    size_t update(Layer* layer);
+
+    /// Type of the grid entity at tile `x`, `y` as of the last update, 0 if there is none or the tile is outside of the level
+    ENT_TYPE type_at(uint32_t x, uint32_t y) const
+    {
+        return x < width && y < height ? tile_types[y * width + x] : 0;
+    }
+    /// Type of tile `index` as of the last update, 0 if the index is outside of the level
+    ENT_TYPE type_of(uint32_t index) const
+    {
+        return index < width * height ? tile_types[index] : 0;
+    }
+    /// Number of tiles that changed in the last update
+    size_t num_changed() const
+    {
+        return changed.size();
+    }
+    // Types of all tiles, tile (x, y) is at index y * width + x
+    std::span<const uint16_t> types() const
+    {
+        return tile_types;
+    }
+    // Indices of the tiles that changed in the last update, every tile if it was the first one
+    std::span<const uint32_t> changed_tiles() const
+    {
+        return changed;
+    }
+
+  private:
+    std::array<uint16_t, width * height> tile_types{};
+    std::array<Entity*, width * height> tile_entities{};
+    std::array<uint32_t, width * height> tile_uids{};
+    std::vector<uint32_t> changed;
+    bool synced{false};
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 // The numbers below represent the index in the memory block containing the virtual tables of all the objects
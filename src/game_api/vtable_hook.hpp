@@ -1,14 +1,167 @@
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <cstdint>
 #include <functional>
+#include <new>
 #include <optional>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 void* register_hook_function(void*** vtable, size_t index, void* hook_function);
 void unregister_hook_function(void*** vtable, size_t index);
 void* get_hook_function(void*** vtable, size_t index);
 
+// Open addressing map from pointers to values with linear probing, meant for the lookups done on every call of a hooked
+// function, find is a single probe sequence over one array
+// Values are moved when the map grows or entries are erased, so pointers returned by find are only valid until then
+template <class KeyT, class ValueT>
+class FlatPointerMap
+{
+  public:
+    ValueT* find(KeyT* key)
+    {
+        if (m_Size == 0)
+        {
+            return nullptr;
+        }
+        for (size_t i = slot_of(key);; i = (i + 1) & m_Mask)
+        {
+            if (m_Slots[i].key == key)
+            {
+                return &m_Slots[i].value;
+            }
+            if (m_Slots[i].key == nullptr)
+            {
+                return nullptr;
+            }
+        }
+    }
+    bool contains(KeyT* key)
+    {
+        return find(key) != nullptr;
+    }
+
+    ValueT& operator[](KeyT* key)
+    {
+        if (ValueT* value = find(key))
+        {
+            return *value;
+        }
+        if ((m_Size + 1) * 2 > m_Slots.size())
+        {
+            grow();
+        }
+        size_t i = slot_of(key);
+        while (m_Slots[i].key != nullptr)
+        {
+            i = (i + 1) & m_Mask;
+        }
+        m_Slots[i].key = key;
+        m_Size++;
+        return m_Slots[i].value;
+    }
+
+    void erase(KeyT* key)
+    {
+        if (m_Size == 0)
+        {
+            return;
+        }
+        size_t i = slot_of(key);
+        while (m_Slots[i].key != key)
+        {
+            if (m_Slots[i].key == nullptr)
+            {
+                return;
+            }
+            i = (i + 1) & m_Mask;
+        }
+
+        // Shift following entries back into the hole instead of leaving a tombstone, so lookups never get longer
+        for (size_t j = (i + 1) & m_Mask; m_Slots[j].key != nullptr; j = (j + 1) & m_Mask)
+        {
+            const size_t home = slot_of(m_Slots[j].key);
+            if (((j - home) & m_Mask) >= ((j - i) & m_Mask))
+            {
+                m_Slots[i] = std::move(m_Slots[j]);
+                i = j;
+            }
+        }
+        m_Slots[i] = Slot{};
+        m_Size--;
+    }
+
+  private:
+    struct Slot
+    {
+        KeyT* key{nullptr};
+        ValueT value{};
+    };
+
+    size_t slot_of(KeyT* key) const
+    {
+        return static_cast<size_t>((reinterpret_cast<uintptr_t>(key) >> 4) * 0x9e3779b97f4a7c15ull) & m_Mask;
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old_slots = std::exchange(m_Slots, std::vector<Slot>(std::max<size_t>(m_Slots.size() * 2, 16)));
+        m_Mask = m_Slots.size() - 1;
+        m_Size = 0;
+        for (Slot& slot : old_slots)
+        {
+            if (slot.key != nullptr)
+            {
+                (*this)[slot.key] = std::move(slot.value);
+            }
+        }
+    }
+
+    std::vector<Slot> m_Slots;
+    size_t m_Mask{0};
+    size_t m_Size{0};
+};
+
+// Callable stored inline without any allocation, only for trivially copyable callables like captureless lambdas, so it
+// can be copied out of a FlatPointerMap before calling it
+template <class FunT, size_t Size = 2 * sizeof(void*)>
+class InplaceFunction;
+template <class RetT, class... ArgsT, size_t Size>
+class InplaceFunction<RetT(ArgsT...), Size>
+{
+  public:
+    InplaceFunction() = default;
+    template <class CallableT>
+    requires(!std::is_same_v<std::decay_t<CallableT>, InplaceFunction>) InplaceFunction(CallableT&& callable)
+    {
+        using StoredT = std::decay_t<CallableT>;
+        static_assert(sizeof(StoredT) <= Size && alignof(StoredT) <= alignof(void*), "Callable is too big for InplaceFunction");
+        static_assert(std::is_trivially_copyable_v<StoredT>, "InplaceFunction only stores trivially copyable callables");
+        new (m_Storage) StoredT(std::forward<CallableT>(callable));
+        m_Invoke = [](const void* storage, ArgsT... args) -> RetT
+        {
+            return (*static_cast<const StoredT*>(storage))(std::forward<ArgsT>(args)...);
+        };
+    }
+
+    RetT operator()(ArgsT... args) const
+    {
+        return m_Invoke(m_Storage, std::forward<ArgsT>(args)...);
+    }
+    explicit operator bool() const
+    {
+        return m_Invoke != nullptr;
+    }
+
+  private:
+    alignas(void*) unsigned char m_Storage[Size]{};
+    RetT (*m_Invoke)(const void*, ArgsT...){nullptr};
+};
+
 struct VDestructorDetour
 {
     using VFunT = void(void*, bool);
@@ -16,53 +169,56 @@ struct VDestructorDetour
 
     static void detour(void* self, bool destroy)
     {
-        if (s_Tasks.contains(self))
+        VFunT* original = *s_OriginalDtors.find(*(void***)self);
+        if (std::vector<DtorTaskT>* tasks = s_Tasks.find(self))
         {
-            for (auto& task : s_Tasks[self])
+            // Tasks may hook other objects, which moves the entries of s_Tasks around
+            std::vector<DtorTaskT> self_tasks = std::move(*tasks);
+            s_Tasks.erase(self);
+            for (auto& task : self_tasks)
             {
                 task(self);
             }
-            s_Tasks.erase(self);
         }
-        s_OriginalDtors[*(void***)self](self, destroy);
+        original(self, destroy);
     }
 
-    inline static std::unordered_map<void**, VFunT*> s_OriginalDtors{};
-    inline static std::unordered_map<void*, std::vector<DtorTaskT>> s_Tasks{};
+    inline static FlatPointerMap<void*, VFunT*> s_OriginalDtors{};
+    inline static FlatPointerMap<void, std::vector<DtorTaskT>> s_Tasks{};
 };
 
-template <class VFunT>
+// One detour per hooked slot, the detour itself can't tell which slot it was called through, so functions with the same
+// signature in different slots of one vtable need their own originals and hooks
+template <class VFunT, std::size_t VTableIndex>
 requires std::is_function_v<VFunT> struct VTableDetour;
-template <class RetT, class ClassT, class... ArgsT>
-struct VTableDetour<RetT(ClassT*, ArgsT...)>
+template <class RetT, class ClassT, class... ArgsT, std::size_t VTableIndex>
+struct VTableDetour<RetT(ClassT*, ArgsT...), VTableIndex>
 {
     using VFunT = RetT(ClassT*, ArgsT...);
-    using DetourFunT = std::function<RetT(ClassT*, ArgsT..., VFunT*)>;
+    using DetourFunT = InplaceFunction<RetT(ClassT*, ArgsT..., VFunT*)>;
 
     static RetT detour(ClassT* self, ArgsT... args)
     {
         void** vtable = *(void***)self;
-        if constexpr (std::is_void_v<RetT>)
+        VFunT* original = *s_Originals.find(vtable);
+        if (DetourFunT* function = s_Functions.find(self))
         {
-            if (s_Functions.contains(self))
-            {
-                s_Functions[self](self, args..., s_Originals[vtable]);
-                return;
-            }
-            s_Originals[vtable](self, std::move(args)...);
+            // Copied since the hook may hook or unhook other objects, which moves the entries of s_Functions around
+            const DetourFunT hook = *function;
+            return hook(self, std::move(args)..., original);
         }
-        else
+        if (DetourFunT* function = s_VTableFunctions.find(vtable))
         {
-            if (s_Functions.contains(self))
-            {
-                return s_Functions[self](self, args..., s_Originals[vtable]);
-            }
-            return s_Originals[vtable](self, std::move(args)...);
+            const DetourFunT hook = *function;
+            return hook(self, std::move(args)..., original);
         }
+        return original(self, std::move(args)...);
     }
 
-    inline static std::unordered_map<void**, VFunT*> s_Originals{};
-    inline static std::unordered_map<ClassT*, DetourFunT> s_Functions{};
+    inline static FlatPointerMap<void*, VFunT*> s_Originals{};
+    inline static FlatPointerMap<ClassT, DetourFunT> s_Functions{};
+    // Called for objects of a hooked vtable that don't have a hook of their own
+    inline static FlatPointerMap<void*, DetourFunT> s_VTableFunctions{};
 };
 
 template <class HookFunT>
@@ -78,14 +234,14 @@ void hook_dtor(void* obj, HookFunT&& hook_fun, std::size_t dtor_index = 0)
     DestructorDetourT::s_Tasks[obj].push_back(std::forward<HookFunT>(hook_fun));
 }
 
-template <class VTableFunT, class T, class HookFunT>
-void hook_vtable(T* obj, HookFunT&& hook_fun, std::size_t vtable_index, std::size_t dtor_index = 0)
+template <class VTableFunT, std::size_t VTableIndex, class T, class HookFunT>
+void hook_vtable(T* obj, HookFunT&& hook_fun, std::size_t dtor_index = 0)
 {
-    using DetourT = VTableDetour<VTableFunT>;
+    using DetourT = VTableDetour<VTableFunT, VTableIndex>;
     void*** vtable = (void***)obj;
-    if (!get_hook_function(vtable, vtable_index))
+    if (!get_hook_function(vtable, VTableIndex))
     {
-        DetourT::s_Originals[*vtable] = (VTableFunT*)register_hook_function(vtable, vtable_index, (void*)&DetourT::detour);
+        DetourT::s_Originals[*vtable] = (VTableFunT*)register_hook_function(vtable, VTableIndex, (void*)&DetourT::detour);
     }
     DetourT::s_Functions[obj] = hook_fun;
 
@@ -95,14 +251,28 @@ void hook_vtable(T* obj, HookFunT&& hook_fun, std::size_t vtable_index, std::siz
         dtor_index);
 }
 
-template <class VTableFunT, class T, class HookFunT>
-void hook_vtable_no_dtor(T* obj, HookFunT&& hook_fun, std::size_t vtable_index)
+template <class VTableFunT, std::size_t VTableIndex, class T, class HookFunT>
+void hook_vtable_no_dtor(T* obj, HookFunT&& hook_fun)
 {
-    using DetourT = VTableDetour<VTableFunT>;
+    using DetourT = VTableDetour<VTableFunT, VTableIndex>;
     void*** vtable = (void***)obj;
-    if (!get_hook_function(vtable, vtable_index))
+    if (!get_hook_function(vtable, VTableIndex))
     {
-        DetourT::s_Originals[*vtable] = (VTableFunT*)register_hook_function(vtable, vtable_index, (void*)&DetourT::detour);
+        DetourT::s_Originals[*vtable] = (VTableFunT*)register_hook_function(vtable, VTableIndex, (void*)&DetourT::detour);
     }
     DetourT::s_Functions[obj] = hook_fun;
 }
+
+// Hooks the function for every object that shares the vtable of obj, objects that are hooked with hook_vtable still only
+// call their own hook
+template <class VTableFunT, std::size_t VTableIndex, class T, class HookFunT>
+void hook_vtable_for_all(T* obj, HookFunT&& hook_fun)
+{
+    using DetourT = VTableDetour<VTableFunT, VTableIndex>;
+    void*** vtable = (void***)obj;
+    if (!get_hook_function(vtable, VTableIndex))
+    {
+        DetourT::s_Originals[*vtable] = (VTableFunT*)register_hook_function(vtable, VTableIndex, (void*)&DetourT::detour);
+    }
+    DetourT::s_VTableFunctions[*vtable] = hook_fun;
+}
@@ -1254,14 +1254,12 @@ void warp_next_level(size_t num)
     doortypes.push_back(to_id("ENT_TYPE_FLOOR_DOOR_EXIT"));
     doortypes.push_back(to_id("ENT_TYPE_FLOOR_DOOR_COG"));
     doortypes.push_back(to_id("ENT_TYPE_FLOOR_DOOR_EGGPLANT_WORLD"));
-    auto doors = get_entities_by_type(doortypes);
-    for (auto doorid : doors)
-    {
-        ExitDoor* doorent = (ExitDoor*)get_entity_ptr(doorid);
-        if (!doorent->special_door)
-            continue;
-        targets.emplace_back(doorent->world, doorent->level, doorent->theme);
-    }
+    for_each_entity_by(EntityTypeSet{doortypes}, 0, LAYER::BOTH, [&targets](Entity* door)
+                       {
+                           ExitDoor* doorent = (ExitDoor*)door;
+                           if (!doorent->special_door)
+                               return;
+                           targets.emplace_back(doorent->world, doorent->level, doorent->theme); });
 
     if (g_state->theme == 11)
     {
@@ -2364,21 +2362,19 @@ void render_narnia()
     doortypes.push_back(to_id("ENT_TYPE_FLOOR_DOOR_EXIT"));
     doortypes.push_back(to_id("ENT_TYPE_FLOOR_DOOR_COG"));
     doortypes.push_back(to_id("ENT_TYPE_FLOOR_DOOR_EGGPLANT_WORLD"));
-    auto doors = get_entities_by_type(doortypes);
-    for (auto doorid : doors)
-    {
-        ExitDoor* target = (ExitDoor*)get_entity_ptr(doorid);
-        if (!target->special_door)
-            continue;
-        std::string buf = fmt::format("{}-{} {}", target->world, target->level, theme_name(target->theme));
-        if (n > 0)
-            ImGui::SameLine();
-        if (ImGui::Button(buf.c_str()))
-        {
-            warp_inc(target->world, target->level, target->theme);
-        }
-        n++;
-    }
+    for_each_entity_by(EntityTypeSet{doortypes}, 0, LAYER::BOTH, [&n](Entity* door)
+                       {
+                           ExitDoor* target = (ExitDoor*)door;
+                           if (!target->special_door)
+                               return;
+                           std::string buf = fmt::format("{}-{} {}", target->world, target->level, theme_name(target->theme));
+                           if (n > 0)
+                               ImGui::SameLine();
+                           if (ImGui::Button(buf.c_str()))
+                           {
+                               warp_inc(target->world, target->level, target->theme);
+                           }
+                           n++; });
 
     if (g_state->theme == 11)
     {
@@ -2975,30 +2971,26 @@ void render_clickhandler()
     }
     if (options["draw_hitboxes"])
     {
-        for (auto entity : get_entities_by(0, 0xBF, LAYER::PLAYER))
-        {
-            auto ent = get_entity_ptr(entity);
-            if (!ent)
-                continue;
+        static const auto olmec = to_id("ENT_TYPE_ACTIVEFLOOR_OLMEC");
+        for_each_entity_by({}, 0xBF, LAYER::PLAYER, [](Entity* ent)
+                           {
+                               if (ent->type->id == olmec)
+                               {
+                                   render_olmec(ent, ImColor(0, 255, 255, 150));
+                                   return;
+                               }
 
-            if (ent->type->id == to_id("ENT_TYPE_ACTIVEFLOOR_OLMEC"))
-            {
-                render_olmec(ent, ImColor(0, 255, 255, 150));
-                continue;
-            }
+                               if (ent->rendering_info->stop_render)
+                                   return;
 
-            if (ent->rendering_info->stop_render)
-                continue;
-
-            render_hitbox(ent, false, ImColor(0, 255, 255, 150));
-        }
+                               render_hitbox(ent, false, ImColor(0, 255, 255, 150)); });
         g_players = get_players();
         for (auto player : g_players)
         {
             render_hitbox(player, false, ImColor(255, 0, 255, 200));
         }
 
-        auto additional_fixed_entities = {
+        static const EntityTypeSet additional_fixed_entities{std::vector<ENT_TYPE>{
             (ENT_TYPE)CUSTOM_TYPE::LOGICALTRAPTRIGGER,
             to_id("ENT_TYPE_FLOOR_MOTHER_STATUE_PLATFORM"),
             to_id("ENT_TYPE_FLOOR_MOTHER_STATUE"),
@@ -3018,15 +3010,13 @@ void render_clickhandler()
             to_id("ENT_TYPE_FLOOR_STICKYTRAP_CEILING"),
             to_id("ENT_TYPE_FLOOR_DUSTWALL"),
             to_id("ENT_TYPE_FLOOR_TENTACLE_BOTTOM"),
-        };
-        for (auto entity : get_entities_by(additional_fixed_entities, 0, LAYER::PLAYER))
-        {
-            auto ent = get_entity_ptr(entity);
-            if (entity_names[ent->type->id].find("TRIGGER") != std::string::npos)
-                render_hitbox(ent, false, ImColor(255, 0, 0, 150));
-            else
-                render_hitbox(ent, false, ImColor(0, 255, 255, 150));
-        }
+        }};
+        for_each_entity_by(additional_fixed_entities, 0, LAYER::PLAYER, [](Entity* ent)
+                           {
+                               if (entity_names[ent->type->id].find("TRIGGER") != std::string::npos)
+                                   render_hitbox(ent, false, ImColor(255, 0, 0, 150));
+                               else
+                                   render_hitbox(ent, false, ImColor(0, 255, 255, 150)); });
 
         if (ImGui::IsMousePosValid())
         {